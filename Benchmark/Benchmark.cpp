@@ -0,0 +1,340 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "HexBoard.h"
+#include "InferiorCells.h"
+#include "ParallelSearch.h"
+#include "Search.h"
+using namespace std;
+
+// Times the board and search hot paths over the positions of a corpus file and
+// writes one JSON object per line and measurement, so runs of two revisions can
+// be compared line by line.
+//
+// hex_bench [corpus=<file>] [depth=<plies>] [time=<ms>] [only=<text>] [prune=1|0] [threads=<n,n,...>]
+//   depth is the deepest minimax() to time, every depth from 1 up is timed
+//   threads also times next_move()'s search to depth with each count of threads
+//   prune=0 searches without leaving out dead and captured cells
+//   time is how long every measurement runs for at least
+//   only keeps the positions whose name contains text
+
+#ifndef HEX_CORPUS
+#define HEX_CORPUS "positions.txt"
+#endif
+
+// Every allocation of the process comes through here, so a measurement can
+// tell how many allocations an operation makes
+static atomic<uint64_t> allocation_count(0);
+
+void *operator new(size_t size)
+{
+	allocation_count.fetch_add(1, memory_order_relaxed);
+	if (void *memory = malloc(size ? size : 1))
+	{
+		return memory;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	free(memory);
+}
+
+// Keeps the compiler from dropping the work whose results nobody looks at
+static volatile int sink;
+
+struct position
+{
+	string name;
+	int size;
+	vector<pair<int, int>> moves; // RED first, then alternating
+};
+
+struct measurement
+{
+	double ns_per_op;
+	double allocations_per_op;
+	uint64_t iterations;
+};
+
+// A line is a name, a board size and the moves in a1 notation. Blank lines and
+// lines starting with # are skipped.
+static vector<position> load_corpus(const string &path)
+{
+	ifstream in(path);
+	if (!in)
+	{
+		throw runtime_error("can't read " + path);
+	}
+	vector<position> corpus;
+	string line;
+	while (getline(in, line))
+	{
+		istringstream fields(line);
+		position p;
+		if (line.empty() || line[0] == '#' || !(fields >> p.name >> p.size))
+		{
+			continue;
+		}
+		string cell;
+		while (fields >> cell)
+		{
+			int row, col;
+			if (!HexGame::parse_cell(cell, row, col) || row >= p.size || col >= p.size)
+			{
+				throw runtime_error("bad cell " + cell + " in " + p.name);
+			}
+			p.moves.push_back(make_pair(row, col));
+		}
+		corpus.push_back(p);
+	}
+	return corpus;
+}
+
+// Runs operation in batches of doubling size until a batch takes at least
+// min_seconds and reports that batch. One call ahead of the batches warms up
+// buffers that are only allocated the first time.
+template <class Operation>
+static measurement measure(Operation operation, double min_seconds)
+{
+	operation();
+	for (uint64_t iterations = 1; ; iterations *= 2)
+	{
+		const uint64_t allocations = allocation_count.load();
+		const auto start = chrono::steady_clock::now();
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			operation();
+		}
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (seconds >= min_seconds || iterations >= (1ULL << 32))
+		{
+			const double allocated = (double)(allocation_count.load() - allocations);
+			return { seconds * 1e9 / iterations, allocated / iterations, iterations };
+		}
+	}
+}
+
+static void report(const position &p, int stones, const string &operation, const measurement &m, const string &extra = "")
+{
+	char numbers[160];
+	snprintf(numbers, sizeof(numbers), "\"ns_per_op\": %.1f, \"allocations_per_op\": %.2f, \"iterations\": %llu",
+		m.ns_per_op, m.allocations_per_op, (unsigned long long)m.iterations);
+	cout << "{\"position\": \"" << p.name << "\", \"size\": " << p.size << ", \"stones\": " << stones
+		<< ", \"op\": \"" << operation << "\", " << numbers << extra << "}" << endl;
+}
+
+template <int N>
+static void run_position(const position &p, int max_depth, double min_seconds, bool prune, const vector<int> &thread_counts)
+{
+	HexBoard<N> board(p.size);
+	board.set_pruning(prune);
+	HexGame::Player player = HexGame::RED;
+	for (const pair<int, int> &move : p.moves)
+	{
+		board.make_index(player, move.first, move.second);
+		player = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	}
+	const int stones = board.move_count();
+	const pair<int, int> last = p.moves.empty() ? make_pair(-1, -1) : p.moves.back();
+
+	// Per call, for every cell of the board in turn
+	int cell = 0;
+	report(p, stones, "legal_neighbors", measure([&]()
+	{
+		sink = board.legal_neighbors(cell / p.size, cell % p.size).count;
+		cell = cell + 1 < p.size * p.size ? cell + 1 : 0;
+	}, min_seconds));
+
+	report(p, stones, "check_winner", measure([&]() { sink = board.check_winner(); }, min_seconds));
+
+	report(p, stones, "inferior_cells", measure([&]() { sink = inferior_cells(board).count(); }, min_seconds));
+
+	report(p, stones, "longest_sub_length", measure([&]() { sink = board.longest_sub_length(HexGame::BLUE); }, min_seconds));
+
+	const pair<HexGame::Evaluator, const char *> evaluators[] = {
+		{ HexGame::LONGEST_CHAIN, "get_score/longest" },
+		{ HexGame::SHORTEST_PATH, "get_score/shortest" },
+		{ HexGame::TWO_DISTANCE, "get_score/two-distance" },
+		{ HexGame::RESISTANCE, "get_score/resistance" },
+	};
+	for (const auto &evaluator : evaluators)
+	{
+		board.set_evaluator(evaluator.first);
+		report(p, stones, evaluator.second, measure([&]() { sink = board.get_score(HexGame::BLUE, last); }, min_seconds));
+	}
+
+	// What a minimax leaf costs: a stone, both players scored, the stone taken
+	// back. PATTERNS scores both players at once and keeps them for the position,
+	// so it only shows its cost here, and the stone goes on one of two cells in
+	// turn so no call finds the last position kept.
+	const pair<HexGame::Evaluator, const char *> leaves[] = {
+		{ HexGame::LONGEST_CHAIN, "leaf/longest" },
+		{ HexGame::TWO_DISTANCE, "leaf/two-distance" },
+		{ HexGame::PATTERNS, "leaf/patterns" },
+	};
+	for (const auto &evaluator : leaves)
+	{
+		if (board.blank_count() < 2)
+		{
+			break;
+		}
+		const int blanks[2] = { board.blank_list()[0], board.blank_list()[1] };
+		int turn = 0;
+		board.set_evaluator(evaluator.first);
+		report(p, stones, evaluator.second, measure([&]()
+		{
+			const int blank = blanks[turn ^= 1];
+			board.make_index(player, blank);
+			sink = board.get_score(HexGame::BLUE, blank) - board.get_score(HexGame::RED, blank);
+			board.unmake_index();
+		}, min_seconds));
+	}
+
+	// A fresh search every call, the way next_move() does it, without a table so
+	// every call searches the same tree
+	board.set_evaluator(HexGame::TWO_DISTANCE);
+	for (int depth = 1; depth <= max_depth && board.check_winner() == HexGame::BLANK; depth++)
+	{
+		uint64_t nodes = 0;
+		const measurement m = measure([&]()
+		{
+			MinimaxSearch<N> search(board);
+			sink = search.minimax(depth, player, last).score;
+			nodes = search.nodes();
+		}, min_seconds);
+		char extra[96];
+		snprintf(extra, sizeof(extra), ", \"depth\": %d, \"nodes\": %llu, \"nodes_per_sec\": %.0f",
+			depth, (unsigned long long)nodes, nodes / (m.ns_per_op * 1e-9));
+		report(p, stones, "minimax", m, extra);
+	}
+
+	// Time to depth of the Lazy SMP search for every count of threads, each
+	// search starting from an empty table. Clearing the table isn't timed, and
+	// with more than one thread the nodes differ from one search to the next,
+	// so these are averages over the searches that fit in the time.
+	TranspositionTable table(64);
+	double one_thread_ns = 0.0;
+	for (int threads : thread_counts)
+	{
+		if (max_depth <= 0 || board.check_winner() != HexGame::BLANK)
+		{
+			break;
+		}
+		uint64_t searches = 0;
+		uint64_t nodes = 0;
+		double seconds = 0.0;
+		const uint64_t allocations = allocation_count.load();
+		while (searches == 0 || seconds < min_seconds)
+		{
+			table.clear();
+			table.new_search();
+			const auto start = chrono::steady_clock::now();
+			ParallelSearch<N> search(board, &table, threads);
+			sink = search.iterative_deepening(player, last, 0, max_depth).score;
+			seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			nodes += search.nodes();
+			searches++;
+		}
+		const measurement m = { seconds * 1e9 / searches, (double)(allocation_count.load() - allocations) / searches, searches };
+		if (one_thread_ns == 0.0)
+		{
+			one_thread_ns = m.ns_per_op;
+		}
+		char extra[128];
+		snprintf(extra, sizeof(extra), ", \"threads\": %d, \"depth\": %d, \"nodes\": %llu, \"speedup\": %.2f",
+			threads, max_depth, (unsigned long long)(nodes / searches), one_thread_ns / m.ns_per_op);
+		report(p, stones, "time_to_depth", m, extra);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	string corpus_path = HEX_CORPUS;
+	string only;
+	int max_depth = 3;
+	double min_seconds = 0.1;
+	bool prune = true;
+	vector<int> thread_counts;
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+		const size_t equals = arg.find('=');
+		const string key = arg.substr(0, equals);
+		const string value = equals == string::npos ? "" : arg.substr(equals + 1);
+		if (key == "corpus")
+		{
+			corpus_path = value;
+		}
+		else if (key == "depth")
+		{
+			max_depth = atoi(value.c_str());
+		}
+		else if (key == "time")
+		{
+			min_seconds = atoi(value.c_str()) / 1000.0;
+		}
+		else if (key == "only")
+		{
+			only = value;
+		}
+		else if (key == "prune")
+		{
+			prune = atoi(value.c_str()) != 0;
+		}
+		else if (key == "threads")
+		{
+			stringstream list(value);
+			string count;
+			while (getline(list, count, ','))
+			{
+				if (atoi(count.c_str()) > 0) thread_counts.push_back(atoi(count.c_str()));
+			}
+		}
+		else
+		{
+			cerr << "hex_bench [corpus=<file>] [depth=<plies>] [time=<ms>] [only=<text>] [prune=1|0] [threads=<n,n,...>]\n";
+			return 1;
+		}
+	}
+
+	try
+	{
+		for (const position &p : load_corpus(corpus_path))
+		{
+			if (p.name.find(only) == string::npos)
+			{
+				continue;
+			}
+			switch (p.size)
+			{
+#define RUN_POSITION(N) case N: run_position<N>(p, max_depth, min_seconds, prune, thread_counts); break;
+			HEX_FIXED_SIZES(RUN_POSITION)
+#undef RUN_POSITION
+			default:
+				run_position<0>(p, max_depth, min_seconds, prune, thread_counts);
+			}
+		}
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "Analysis.h"
+#include "HexGeometry.h"
+using namespace std;
+
+static const char *const USAGE =
+	"Hex analyze [key=value ...]\n"
+	"  in=- out=- size=8 threads=<cores> window=<8 x threads>\n"
+	"  engine=minimax|mcts eval=longest|shortest|two-distance|resistance|patterns\n"
+	"  time=1000 depth=0 playouts=0 search-threads=1 table=16 book=<file> prune=1|0 patterns=<file>\n"
+	"  a game is a line of moves, RED first, or a line of arena results, and - is stdin or stdout.\n"
+	"  Scores are BLUE's for minimax and the win chance in percent of the player to move for mcts.\n";
+
+static const char *const HEADER = "# game ply player best played score depth nodes ms\n";
+
+AnalysisSettings::AnalysisSettings()
+{
+	const int cores = (int)thread::hardware_concurrency();
+	size = 8;
+	threads = cores > 0 ? cores : 1;
+	window = 8 * threads;
+	input_path = "-";
+	output_path = "-";
+
+	// What next_move() searches with unless told otherwise
+	engine.move_time_ms = 1000;
+	engine.max_depth = 0;
+	engine.playouts = 0;
+	engine.table_megabytes = 16;
+}
+
+GameAnalyzer::GameAnalyzer(const AnalysisSettings &settings)
+	: settings(settings), size(settings.size), issued(0), written(0), finished(false), games(0), skipped(0), positions(0)
+{
+	// Throws for a size make_board() can't do, or a book or weights the engine
+	// can't use, before any thread starts
+	unique_ptr<HexGame> board = make_board(settings.size);
+	settings.engine.apply(*board);
+	this->settings.threads = max(settings.threads, 1);
+	this->settings.window = max(settings.window, 1);
+	slots.assign(this->settings.window, slot());
+}
+
+void GameAnalyzer::run(istream &in, ostream &out)
+{
+	out << HEADER;
+	vector<thread> workers;
+	for (int i = 0; i < settings.threads; i++)
+	{
+		workers.emplace_back(&GameAnalyzer::work, this);
+	}
+
+	string line;
+	for (int number = 1; getline(in, line); number++)
+	{
+		read_line(line, number, out);
+	}
+	{
+		lock_guard<mutex> guard(lock);
+		finished = true;
+	}
+	task_added.notify_all();
+
+	for (;;)
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			if (written == issued)
+			{
+				break;
+			}
+		}
+		write_ready(out, true);
+	}
+	for (thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void GameAnalyzer::read_line(const string &line, int number, ostream &out)
+{
+	if (line.compare(0, 7, "# size ") == 0)
+	{
+		size = atoi(line.c_str() + 7);
+		return;
+	}
+	if (line.empty() || line[0] == '#')
+	{
+		return;
+	}
+
+	string text = line;
+	replace(text.begin(), text.end(), ',', ' ');
+	istringstream fields(text);
+	vector<string> names;
+	string name;
+	while (fields >> name)
+	{
+		names.push_back(name);
+	}
+	if (names.empty())
+	{
+		return;
+	}
+
+	// An arena results line has the game number, the colors, the think times
+	// and the opening length before its moves
+	const size_t first = isdigit((unsigned char)names[0][0]) ? 6 : 0;
+
+	shared_ptr<game> record = make_shared<game>();
+	record->number = games++;
+	record->size = size;
+	string error;
+	if (size < 1 || size > HexGeometry<0>::MAX_SIZE)
+	{
+		error = "the size is " + to_string(size);
+	}
+	else if (first > names.size())
+	{
+		error = "the line is cut short";
+	}
+
+	// Replayed here so a bad game is caught before any of it is searched
+	unique_ptr<HexGame> board = error.empty() ? make_board(size) : nullptr;
+	HexGame::Player winner = HexGame::BLANK;
+	for (size_t i = first; error.empty() && i < names.size(); i++)
+	{
+		int row, col;
+		if (!HexGame::parse_cell(names[i], row, col) || row >= size || col >= size)
+		{
+			error = names[i] + " is not a cell";
+		}
+		else if (board->get_node_value(row, col) != HexGame::BLANK)
+		{
+			error = names[i] + " is taken";
+		}
+		else if (winner != HexGame::BLANK)
+		{
+			error = "the game goes on after it is won";
+		}
+		else
+		{
+			board->make_index(record->moves.size() % 2 == 0 ? HexGame::RED : HexGame::BLUE, row, col);
+			record->moves.push_back(row * size + col);
+			winner = board->check_winner();
+		}
+	}
+	if (!error.empty())
+	{
+		skipped++;
+		submit(nullptr, 0, "# game " + to_string(record->number) + " on line " + to_string(number) + " skipped, " + error + "\n", out);
+		return;
+	}
+
+	// Every position with a move to find, the one after the last move too
+	// when the game stopped before anybody won
+	const int last = (int)record->moves.size() - (winner != HexGame::BLANK ? 1 : 0);
+	for (int ply = 0; ply <= last; ply++)
+	{
+		submit(record, ply, string(), out);
+	}
+}
+
+void GameAnalyzer::submit(shared_ptr<const game> record, int ply, const string &line, ostream &out)
+{
+	for (;;)
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			if (issued - written < (uint64_t)settings.window)
+			{
+				slot &next = slots[issued % settings.window];
+				if (record)
+				{
+					tasks.push_back(task{ record, ply, issued });
+				}
+				else
+				{
+					next.line = line;
+					next.ready = true;
+				}
+				issued++;
+				break;
+			}
+		}
+		write_ready(out, true);
+	}
+	if (record)
+	{
+		task_added.notify_one();
+	}
+	write_ready(out, false);
+}
+
+void GameAnalyzer::write_ready(ostream &out, bool wait)
+{
+	string text;
+	{
+		unique_lock<mutex> guard(lock);
+		if (wait)
+		{
+			slot_filled.wait(guard, [this]() { return written == issued || slots[written % settings.window].ready; });
+		}
+		while (written < issued && slots[written % settings.window].ready)
+		{
+			slot &next = slots[written % settings.window];
+			text += next.line;
+			next.line.clear();
+			next.ready = false;
+			written++;
+		}
+	}
+	if (!text.empty())
+	{
+		out << text;
+		out.flush();
+	}
+}
+
+void GameAnalyzer::work()
+{
+	// The board of the last position searched and the stones on it, in order
+	unique_ptr<HexGame> board;
+	vector<int> placed;
+	for (;;)
+	{
+		task job;
+		{
+			unique_lock<mutex> guard(lock);
+			task_added.wait(guard, [this]() { return !tasks.empty() || finished; });
+			if (tasks.empty())
+			{
+				return;
+			}
+			job = tasks.front();
+			tasks.pop_front();
+		}
+
+		string line = search(board, placed, job);
+		{
+			lock_guard<mutex> guard(lock);
+			slot &done = slots[job.sequence % settings.window];
+			done.line.swap(line);
+			done.ready = true;
+			positions++;
+		}
+		slot_filled.notify_one();
+	}
+}
+
+string GameAnalyzer::search(unique_ptr<HexGame> &board, vector<int> &placed, const task &job) const
+{
+	const game &record = *job.record;
+	const int n = record.size;
+	try
+	{
+		if (!board || board->V() != n)
+		{
+			board.reset();
+			placed.clear();
+			board = make_board(n);
+			settings.engine.apply(*board);
+		}
+
+		// Keep the stones this position starts with, but always put the last
+		// one down again, since that is the move the search scores from
+		size_t keep = 0;
+		const size_t shared = min(placed.size(), (size_t)(job.ply > 0 ? job.ply - 1 : 0));
+		while (keep < shared && placed[keep] == record.moves[keep])
+		{
+			keep++;
+		}
+		while (placed.size() > keep)
+		{
+			board->make_index(HexGame::BLANK, placed.back() / n, placed.back() % n);
+			placed.pop_back();
+		}
+		while ((int)placed.size() < job.ply)
+		{
+			const int cell = record.moves[placed.size()];
+			board->make_index(placed.size() % 2 == 0 ? HexGame::RED : HexGame::BLUE, cell / n, cell % n);
+			placed.push_back(cell);
+		}
+
+		const HexGame::Player player = job.ply % 2 == 0 ? HexGame::RED : HexGame::BLUE;
+		const auto start = chrono::steady_clock::now();
+		const ai_move best = board->find_move(player);
+		const double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		const search_info &info = board->last_search();
+
+		const string played = job.ply < (int)record.moves.size()
+			? HexGame::cell_name(record.moves[job.ply] / n, record.moves[job.ply] % n) : "-";
+		char text[160];
+		snprintf(text, sizeof(text), "%llu %d %s %s %s %d %d %llu %.1f\n",
+			(unsigned long long)record.number, job.ply, player == HexGame::RED ? "red" : "blue",
+			HexGame::cell_name(best.x, best.y).c_str(), played.c_str(), best.score, info.depth,
+			(unsigned long long)info.nodes, milliseconds);
+		return text;
+	}
+	catch (const exception &error)
+	{
+		board.reset();
+		placed.clear();
+		return "# game " + to_string(record.number) + " ply " + to_string(job.ply) + " failed, " + error.what() + "\n";
+	}
+}
+
+int run_analysis(int argc, char *argv[])
+{
+	AnalysisSettings settings;
+	bool window_set = false;
+	for (int i = 0; i < argc; i++)
+	{
+		const string argument = argv[i];
+		const size_t equals = argument.find('=');
+		const string key = equals == string::npos ? "" : argument.substr(0, equals);
+		const string value = equals == string::npos ? "" : argument.substr(equals + 1);
+
+		if (key == "in") settings.input_path = value;
+		else if (key == "out") settings.output_path = value;
+		else if (key == "size") settings.size = atoi(value.c_str());
+		else if (key == "threads") settings.threads = atoi(value.c_str());
+		else if (key == "window") settings.window = atoi(value.c_str()), window_set = true;
+		else if (key == "search-threads") settings.engine.threads = atoi(value.c_str());
+		else if (key.empty() || !settings.engine.parse(key, value))
+		{
+			cerr << "Unknown analysis setting " << argument << "\n" << USAGE;
+			return 1;
+		}
+	}
+	string why;
+	if (!settings.engine.budgeted(why))
+	{
+		cerr << why << "\n" << USAGE;
+		return 1;
+	}
+	if (!window_set)
+	{
+		settings.window = 8 * max(settings.threads, 1);
+	}
+
+	ifstream input_file;
+	ofstream output_file;
+	if (settings.input_path != "-")
+	{
+		input_file.open(settings.input_path);
+		if (!input_file)
+		{
+			cerr << "Can't read " << settings.input_path << "\n";
+			return 1;
+		}
+	}
+	if (settings.output_path != "-")
+	{
+		output_file.open(settings.output_path);
+		if (!output_file)
+		{
+			cerr << "Can't write " << settings.output_path << "\n";
+			return 1;
+		}
+	}
+	istream &in = settings.input_path == "-" ? cin : input_file;
+	ostream &out = settings.output_path == "-" ? cout : output_file;
+
+	try
+	{
+		GameAnalyzer analyzer(settings);
+		const auto start = chrono::steady_clock::now();
+		analyzer.run(in, out);
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		char summary[160];
+		snprintf(summary, sizeof(summary), "%llu games, %llu skipped, %llu positions in %.1f s with %d threads\n",
+			(unsigned long long)analyzer.games_read(), (unsigned long long)analyzer.games_skipped(),
+			(unsigned long long)analyzer.positions_searched(), seconds, max(settings.threads, 1));
+		out << "# " << summary;
+		out.flush();
+		if (settings.output_path != "-")
+		{
+			cout << summary;
+		}
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
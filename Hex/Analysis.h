@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "HexGame.h"
+
+struct AnalysisSettings
+{
+	AnalysisSettings();
+
+	int size;                // of the boards, until a "# size" line says otherwise
+	int threads;             // positions searched at the same time
+	int window;              // positions read ahead of the oldest one not written yet
+	std::string input_path;  // "-" for stdin
+	std::string output_path; // "-" for stdout
+	ArenaPlayer engine;      // what every position is searched with
+};
+
+// Searches every position of recorded games the way find_move() does and
+// writes what it found, a line per position in the order of the input.
+//
+// Games are read one line at a time: the moves in the usual notation, RED
+// first, apart by spaces or commas. A line of an arena results file is a game
+// too, and its "# size" line sets the size of the games after it. The reader
+// replays every game to check it and hands its positions to a pool of worker
+// threads, each with a board of its own that goes from one position to the
+// next by taking back and playing only the stones that differ. Lines are
+// written as soon as the ones before them are, and the reader waits while
+// window positions are out, so memory doesn't grow with the input.
+//
+// A worker keeps its transposition table from one position to the next, as
+// next_move() does from one move to the next, so with a depth limit a result
+// can depend on what the worker searched before. table=0 makes every search
+// stand alone, and the same for any number of threads.
+//
+// A game that can't be replayed gets a comment line saying why instead of
+// its positions.
+class GameAnalyzer
+{
+public:
+	explicit GameAnalyzer(const AnalysisSettings &settings);
+
+	// Reads games until the end of in, blocking until every line is written to out
+	void run(std::istream &in, std::ostream &out);
+
+	inline uint64_t games_read() const { return games; };
+	inline uint64_t games_skipped() const { return skipped; };
+	inline uint64_t positions_searched() const { return positions; };
+
+private:
+	struct game
+	{
+		uint64_t number; // counting from 0 in the order of the input
+		int size;
+		std::vector<int> moves; // cells as row * size + col, RED first
+	};
+
+	struct task
+	{
+		std::shared_ptr<const game> record;
+		int ply; // stones on the board
+		uint64_t sequence;
+	};
+
+	// A line of the output, ready once its position is searched
+	struct slot
+	{
+		bool ready;
+		std::string line;
+	};
+
+	void read_line(const std::string &line, int number, std::ostream &out);
+	void submit(std::shared_ptr<const game> record, int ply, const std::string &line, std::ostream &out);
+	void write_ready(std::ostream &out, bool wait);
+	void work();
+	std::string search(std::unique_ptr<HexGame> &board, std::vector<int> &placed, const task &job) const;
+
+	AnalysisSettings settings;
+	int size; // of the games being read
+
+	std::mutex lock;
+	std::condition_variable task_added;
+	std::condition_variable slot_filled;
+	std::deque<task> tasks;
+	std::vector<slot> slots; // a window of them, by sequence number
+	uint64_t issued;
+	uint64_t written;
+	bool finished; // no more tasks are coming
+
+	uint64_t games;
+	uint64_t skipped;
+	uint64_t positions;
+};
+
+// Hex analyze [key=value ...], see the usage text in Analysis.cpp
+int run_analysis(int argc, char *argv[]);
@@ -0,0 +1,516 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "Arena.h"
+using namespace std;
+
+static const char *const USAGE =
+	"Hex arena [key=value ...]\n"
+	"  games=100 size=8 threads=<cores> opening=2 seed=1 out=arena.txt\n"
+	"  a.<setting>=value and b.<setting>=value set up the two players:\n"
+	"  engine=minimax|mcts eval=longest|shortest|two-distance|resistance|patterns\n"
+	"  time=<ms> depth=<plies> playouts=<count> threads=<count> table=<MB> book=<file>\n"
+	"  prune=1|0 patterns=<file>\n";
+
+static const char *const ENGINE_NAMES[] = { "minimax", "mcts" };
+static const char *const EVALUATOR_NAMES[] = { "longest", "shortest", "two-distance", "resistance", "patterns" };
+
+// 95% confidence
+static const double Z = 1.96;
+
+// Same generator as the Zobrist keys, one independent stream per opening
+static uint64_t splitmix64(uint64_t &state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Wilson score interval of a win rate, which behaves near 0% and 100% too
+static void confidence_interval(int wins, int games, double &low, double &high)
+{
+	if (games == 0)
+	{
+		low = 0.0;
+		high = 1.0;
+		return;
+	}
+	const double p = (double)wins / games;
+	const double z2 = Z * Z / games;
+	const double center = (p + z2 / 2) / (1 + z2);
+	const double spread = Z * sqrt(p * (1 - p) / games + z2 / (4.0 * games)) / (1 + z2);
+	low = center - spread > 0.0 ? center - spread : 0.0;
+	high = center + spread < 1.0 ? center + spread : 1.0;
+}
+
+static string format(const char *pattern, double a, double b = 0.0, double c = 0.0)
+{
+	char text[128];
+	snprintf(text, sizeof(text), pattern, a, b, c);
+	return text;
+}
+
+ArenaPlayer::ArenaPlayer()
+{
+	// Fast enough for thousands of games on a small board
+	engine = HexGame::MINIMAX;
+	evaluator = HexGame::TWO_DISTANCE;
+	move_time_ms = 0;
+	max_depth = 2;
+	playouts = 1000;
+	threads = 1;
+	table_megabytes = 2;
+	pruning = true;
+}
+
+string ArenaPlayer::describe() const
+{
+	string text = ENGINE_NAMES[engine];
+	if (engine == HexGame::MINIMAX)
+	{
+		text += string(" ") + EVALUATOR_NAMES[evaluator];
+		if (evaluator == HexGame::PATTERNS && !patterns_path.empty())
+		{
+			text += " from " + patterns_path;
+		}
+		if (max_depth > 0)
+		{
+			text += " depth " + to_string(max_depth);
+		}
+		if (!pruning)
+		{
+			text += " unpruned";
+		}
+	}
+	else if (playouts > 0)
+	{
+		text += " " + to_string(playouts) + " playouts";
+	}
+	if (move_time_ms > 0)
+	{
+		text += " " + to_string(move_time_ms) + " ms";
+	}
+	if (threads > 1)
+	{
+		text += " " + to_string(threads) + " threads";
+	}
+	if (!book_path.empty())
+	{
+		text += " with " + book_path;
+	}
+	return text;
+}
+
+ArenaSettings::ArenaSettings()
+{
+	const int cores = (int)thread::hardware_concurrency();
+	size = 8;
+	games = 100;
+	threads = cores > 0 ? cores : 1;
+	opening_moves = 2;
+	seed = 1;
+	results_path = "arena.txt";
+}
+
+Arena::Arena(const ArenaSettings &settings) : settings(settings), seconds(0.0)
+{
+	// Throws for a size make_board() can't do, a book that isn't one for the
+	// size, or weights that can't be read, before any thread starts
+	unique_ptr<HexGame> board = make_board(settings.size);
+	for (const ArenaPlayer &player : settings.players)
+	{
+		player.apply(*board);
+	}
+}
+
+void Arena::run()
+{
+	records.assign(settings.games > 0 ? settings.games : 0, game_record());
+
+	const auto start = chrono::steady_clock::now();
+	atomic<int> next_game(0);
+	auto worker = [this, &next_game]()
+	{
+		for (int game = next_game++; game < (int)records.size(); game = next_game++)
+		{
+			play(game, records[game]);
+		}
+	};
+
+	const int thread_count = settings.threads < settings.games ? settings.threads : settings.games;
+	vector<thread> workers;
+	for (int i = 1; i < thread_count; i++)
+	{
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (thread &t : workers)
+	{
+		t.join();
+	}
+	seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void Arena::play(int game, game_record &record) const
+{
+	// Both players keep their own board, so neither sees the other's table
+	unique_ptr<HexGame> boards[2];
+	for (int side = 0; side < 2; side++)
+	{
+		boards[side] = make_board(settings.size);
+		settings.players[side].apply(*boards[side]);
+		record.think_ms[side] = 0.0;
+		record.thinks[side] = 0;
+	}
+	record.red = game % 2;
+	record.moves.clear();
+
+	// Random stones for both colors, the same for the two games of a pair
+	const int cells = settings.size * settings.size;
+	vector<int> free_cells(cells);
+	for (int i = 0; i < cells; i++)
+	{
+		free_cells[i] = i;
+	}
+	uint64_t state = settings.seed ^ ((uint64_t)(game / 2) * 0xD1B54A32D192ED03ULL);
+	const int opening = settings.opening_moves < cells ? settings.opening_moves : cells;
+	for (int i = 0; i < opening; i++)
+	{
+		const int pick = (int)(splitmix64(state) % free_cells.size());
+		record.moves.push_back(free_cells[pick]);
+		free_cells[pick] = free_cells.back();
+		free_cells.pop_back();
+	}
+	record.opening = opening;
+
+	HexGame::Player to_move = HexGame::RED;
+	for (int cell : record.moves)
+	{
+		boards[0]->make_index(to_move, cell / settings.size, cell % settings.size);
+		boards[1]->make_index(to_move, cell / settings.size, cell % settings.size);
+		to_move = to_move == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	}
+
+	HexGame::Player winner = boards[0]->check_winner();
+	while (winner == HexGame::BLANK)
+	{
+		const int side = (to_move == HexGame::RED) == (record.red == 0) ? 0 : 1;
+		const auto start = chrono::steady_clock::now();
+		const ai_move move = boards[side]->find_move(to_move);
+		record.think_ms[side] += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		record.thinks[side]++;
+
+		// An engine that can't come up with a blank cell loses the game
+		if (move.x < 0 || move.x >= settings.size || move.y < 0 || move.y >= settings.size
+			|| boards[0]->get_node_value(move.x, move.y) != HexGame::BLANK)
+		{
+			winner = to_move == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+			break;
+		}
+		record.moves.push_back(move.x * settings.size + move.y);
+		boards[0]->make_index(to_move, move.x, move.y);
+		boards[1]->make_index(to_move, move.x, move.y);
+		winner = boards[0]->check_winner();
+		to_move = to_move == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	}
+	record.winner = (winner == HexGame::RED) == (record.red == 0) ? 0 : 1;
+}
+
+void Arena::summarize(vector<string> &lines) const
+{
+	const int games = (int)records.size();
+	int wins[2] = {};
+	int red_wins = 0;
+	double think_ms[2] = {};
+	int thinks[2] = {};
+	for (const game_record &record : records)
+	{
+		wins[record.winner]++;
+		red_wins += record.winner == record.red ? 1 : 0;
+		for (int side = 0; side < 2; side++)
+		{
+			think_ms[side] += record.think_ms[side];
+			thinks[side] += record.thinks[side];
+		}
+	}
+
+	lines.push_back(to_string(games) + " games on " + to_string(settings.size) + "x" + to_string(settings.size)
+		+ format(" in %.2f s, %.2f games/s", seconds, seconds > 0.0 ? games / seconds : 0.0));
+	for (int side = 0; side < 2; side++)
+	{
+		double low, high;
+		confidence_interval(wins[side], games, low, high);
+		lines.push_back(string(side == 0 ? "a" : "b") + " (" + settings.players[side].describe() + "): "
+			+ to_string(wins[side]) + " wins, "
+			+ format("%.1f%% [%.1f%%, %.1f%%], ", games ? 100.0 * wins[side] / games : 0.0, 100 * low, 100 * high)
+			+ format("%.3f ms/move", thinks[side] ? think_ms[side] / thinks[side] : 0.0));
+	}
+	double low, high;
+	confidence_interval(red_wins, games, low, high);
+	lines.push_back("red: " + to_string(red_wins) + " wins, "
+		+ format("%.1f%% [%.1f%%, %.1f%%]", games ? 100.0 * red_wins / games : 0.0, 100 * low, 100 * high));
+}
+
+void Arena::write_results(const string &path) const
+{
+	ofstream out(path);
+	if (!out)
+	{
+		throw runtime_error("can't write " + path);
+	}
+	out << "# size " << settings.size << " seed " << settings.seed << " opening " << settings.opening_moves << "\n";
+	out << "# game red winner a_ms b_ms opening moves...\n";
+	for (size_t game = 0; game < records.size(); game++)
+	{
+		const game_record &record = records[game];
+		out << game << ' ' << (record.red == 0 ? 'a' : 'b') << ' ' << (record.winner == 0 ? 'a' : 'b')
+			<< format(" %.1f %.1f ", record.think_ms[0], record.think_ms[1]) << record.opening;
+		for (int cell : record.moves)
+		{
+			out << ' ' << HexGame::cell_name(cell / settings.size, cell % settings.size);
+		}
+		out << '\n';
+	}
+	vector<string> lines;
+	summarize(lines);
+	for (const string &line : lines)
+	{
+		out << "# " << line << '\n';
+	}
+}
+
+vector<ArenaGame> read_arena_games(const string &path)
+{
+	ifstream in(path);
+	if (!in)
+	{
+		throw runtime_error("can't read " + path);
+	}
+	vector<ArenaGame> games;
+	int size = 0;
+	string line;
+	for (int number = 1; getline(in, line); number++)
+	{
+		if (line.compare(0, 7, "# size ") == 0)
+		{
+			size = atoi(line.c_str() + 7);
+		}
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		istringstream fields(line);
+		ArenaGame game;
+		game.size = size;
+		int index;
+		string red, winner;
+		double think_ms[2];
+		bool valid = size > 0 && fields >> index >> red >> winner >> think_ms[0] >> think_ms[1] >> game.opening;
+		game.winner = red == winner ? HexGame::RED : HexGame::BLUE;
+		string name;
+		while (valid && fields >> name)
+		{
+			int row, col;
+			valid = HexGame::parse_cell(name, row, col) && row < size && col < size;
+			game.moves.push_back(row * size + col);
+		}
+		if (!valid)
+		{
+			throw runtime_error(path + " line " + to_string(number) + " is not a game");
+		}
+		games.push_back(move(game));
+	}
+	return games;
+}
+
+void Arena::print_summary() const
+{
+	vector<string> lines;
+	summarize(lines);
+	for (const string &line : lines)
+	{
+		cout << line << '\n';
+	}
+	cout.flush();
+}
+
+static bool parse_name(const string &value, const char *const *names, int count, int &result)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (value == names[i])
+		{
+			result = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ArenaPlayer::parse(const string &key, const string &value)
+{
+	int choice;
+	if (key == "engine" && parse_name(value, ENGINE_NAMES, 2, choice))
+	{
+		engine = (HexGame::Engine)choice;
+	}
+	else if (key == "eval" && parse_name(value, EVALUATOR_NAMES, 5, choice))
+	{
+		evaluator = (HexGame::Evaluator)choice;
+	}
+	else if (key == "time")
+	{
+		move_time_ms = atoi(value.c_str());
+	}
+	else if (key == "depth")
+	{
+		max_depth = atoi(value.c_str());
+	}
+	else if (key == "playouts")
+	{
+		playouts = strtoull(value.c_str(), nullptr, 10);
+	}
+	else if (key == "threads")
+	{
+		threads = atoi(value.c_str());
+	}
+	else if (key == "table")
+	{
+		table_megabytes = strtoul(value.c_str(), nullptr, 10);
+	}
+	else if (key == "prune")
+	{
+		pruning = atoi(value.c_str()) != 0;
+	}
+	else if (key == "book")
+	{
+		book_path = value;
+	}
+	else if (key == "patterns")
+	{
+		patterns_path = value;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void ArenaPlayer::apply(HexGame &board) const
+{
+	board.set_engine(engine);
+	board.set_evaluator(evaluator);
+	board.set_move_time(move_time_ms);
+	board.set_max_depth(max_depth);
+	board.set_playouts(playouts);
+	board.set_threads(threads);
+	board.set_table_size(table_megabytes);
+	board.set_opening_book(book_path);
+	board.set_pruning(pruning);
+	board.set_pattern_weights(patterns_path);
+}
+
+bool ArenaPlayer::budgeted(string &why) const
+{
+	if (engine == HexGame::MINIMAX && move_time_ms <= 0 && max_depth <= 0)
+	{
+		why = "A minimax player needs a time or a depth";
+		return false;
+	}
+	if (engine == HexGame::MCTS && move_time_ms <= 0 && playouts == 0)
+	{
+		why = "An mcts player needs a time or playouts";
+		return false;
+	}
+	return true;
+}
+
+static bool parse_setting(const string &argument, ArenaSettings &settings)
+{
+	const size_t equals = argument.find('=');
+	if (equals == string::npos)
+	{
+		return false;
+	}
+	const string key = argument.substr(0, equals);
+	const string value = argument.substr(equals + 1);
+	if (key.compare(0, 2, "a.") == 0 || key.compare(0, 2, "b.") == 0)
+	{
+		return settings.players[key[0] == 'a' ? 0 : 1].parse(key.substr(2), value);
+	}
+	if (key == "games")
+	{
+		settings.games = atoi(value.c_str());
+	}
+	else if (key == "size")
+	{
+		settings.size = atoi(value.c_str());
+	}
+	else if (key == "threads")
+	{
+		settings.threads = atoi(value.c_str());
+	}
+	else if (key == "opening")
+	{
+		settings.opening_moves = atoi(value.c_str());
+	}
+	else if (key == "seed")
+	{
+		settings.seed = strtoull(value.c_str(), nullptr, 10);
+	}
+	else if (key == "out")
+	{
+		settings.results_path = value;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+int run_arena(int argc, char *argv[])
+{
+	ArenaSettings settings;
+	for (int i = 0; i < argc; i++)
+	{
+		if (!parse_setting(argv[i], settings))
+		{
+			cerr << "Unknown arena setting " << argv[i] << "\n" << USAGE;
+			return 1;
+		}
+	}
+	for (const ArenaPlayer &player : settings.players)
+	{
+		string why;
+		if (!player.budgeted(why))
+		{
+			cerr << why << "\n" << USAGE;
+			return 1;
+		}
+	}
+
+	try
+	{
+		Arena arena(settings);
+		arena.run();
+		arena.write_results(settings.results_path);
+		arena.print_summary();
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "HexGame.h"
+
+// The AI settings of one side of an arena match, or of the engine a batch
+// analysis searches with, applied to a board with the HexGame setters
+struct ArenaPlayer
+{
+	ArenaPlayer();
+
+	// Sets the setting named by key from its text, false when there is no such
+	// setting or the value isn't one of its choices
+	bool parse(const std::string &key, const std::string &value);
+
+	// Throws what the setters throw, for a book or weights it can't use
+	void apply(HexGame &board) const;
+
+	// False with the reason in why when the engine has nothing to stop its
+	// search, a minimax player with neither time nor depth or an mcts player
+	// with neither time nor playouts
+	bool budgeted(std::string &why) const;
+
+	HexGame::Engine engine;
+	HexGame::Evaluator evaluator;
+	int move_time_ms;
+	int max_depth;
+	uint64_t playouts;
+	int threads;
+	size_t table_megabytes;
+	bool pruning;
+	std::string book_path;     // empty for no opening book
+	std::string patterns_path; // weights for eval=patterns, empty for the built in ones
+
+	// A short description for the results, like "minimax two-distance depth 2"
+	std::string describe() const;
+};
+
+struct ArenaSettings
+{
+	ArenaSettings();
+
+	int size;
+	int games;
+	int threads;       // games played at the same time
+	int opening_moves; // random stones placed before the engines take over
+	uint64_t seed;
+	std::string results_path;
+	ArenaPlayer players[2];
+};
+
+// Plays the two players of the settings against each other without a human and
+// without printing a board. Games are handed out to a pool of threads, every
+// game has its own pair of boards and its opening only depends on the seed and
+// the game number, so a match with depth or playout limits plays the same
+// games whatever the number of threads. Games come in pairs that share an
+// opening, with the first player on RED in the even game and on BLUE in the odd one.
+class Arena
+{
+public:
+	explicit Arena(const ArenaSettings &settings);
+
+	// Plays every game, blocking until they are done
+	void run();
+
+	// One line per game and the summary as comments, see the file header
+	void write_results(const std::string &path) const;
+
+	void print_summary() const;
+
+private:
+	struct game_record {
+		int red;     // player 0 or 1 on RED, who moves first
+		int winner;  // player 0 or 1
+		int opening; // how many of moves were random
+		double think_ms[2];
+		int thinks[2];
+		std::vector<int> moves; // cells as row * size + col, RED first
+	};
+
+	void play(int game, game_record &record) const;
+	void summarize(std::vector<std::string> &lines) const;
+
+	ArenaSettings settings;
+	std::vector<game_record> records;
+	double seconds;
+};
+
+// A game read back from a results file
+struct ArenaGame
+{
+	int size;
+	int opening;            // how many of moves were random
+	HexGame::Player winner;
+	std::vector<int> moves; // cells as row * size + col, RED first
+};
+
+// The games of a file written by Arena::write_results(). Throws runtime_error
+// when the file can't be read or a line isn't a game.
+std::vector<ArenaGame> read_arena_games(const std::string &path);
+
+// Hex arena [key=value ...], see the usage text in Arena.cpp
+int run_arena(int argc, char *argv[]);
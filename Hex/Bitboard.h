@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Portable helpers for the 64 bit words that make up a bitboard
+inline int bit_scan_forward(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)x)) return (int)index;
+	_BitScanForward(&index, (unsigned long)(x >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+inline int bit_scan_reverse(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(x >> 32))) return (int)index + 32;
+	_BitScanReverse(&index, (unsigned long)x);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(x);
+#endif
+}
+
+inline int pop_count(uint64_t x)
+{
+#if defined(_MSC_VER)
+	// __popcnt64 needs hardware support, so use the SWAR count instead
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+#else
+	return __builtin_popcountll(x);
+#endif
+}
+
+// A fixed size set of cells, one bit per cell in row major order, held in Words
+// 64 bit words. The size is part of the type so copying one never allocates, and
+// every loop over the words has a trip count the compiler knows.
+template <int Words>
+class BasicBitboard
+{
+public:
+	static const int WORDS = Words;
+	static const int MAX_BITS = Words * 64;
+
+	BasicBitboard() : words() {}
+
+	inline void set(int i) { words[i >> 6] |= 1ULL << (i & 63); }
+	inline void reset(int i) { words[i >> 6] &= ~(1ULL << (i & 63)); }
+	inline bool test(int i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+
+	inline uint64_t word(int w) const { return words[w]; }
+
+	bool any() const
+	{
+		uint64_t acc = 0;
+		for (int w = 0; w < WORDS; w++) acc |= words[w];
+		return acc != 0;
+	}
+	inline bool none() const { return !any(); }
+
+	int count() const
+	{
+		int total = 0;
+		for (int w = 0; w < WORDS; w++) total += pop_count(words[w]);
+		return total;
+	}
+
+	// Lowest set bit, or -1 when the set is empty
+	int first() const
+	{
+		for (int w = 0; w < WORDS; w++)
+		{
+			if (words[w]) return (w << 6) + bit_scan_forward(words[w]);
+		}
+		return -1;
+	}
+
+	// Highest set bit, or -1 when the set is empty
+	int last() const
+	{
+		for (int w = WORDS - 1; w >= 0; w--)
+		{
+			if (words[w]) return (w << 6) + bit_scan_reverse(words[w]);
+		}
+		return -1;
+	}
+
+	// Removes and returns the lowest set bit, the set must not be empty
+	inline int pop_first()
+	{
+		const int i = first();
+		reset(i);
+		return i;
+	}
+
+	bool intersects(const BasicBitboard &other) const
+	{
+		uint64_t acc = 0;
+		for (int w = 0; w < WORDS; w++) acc |= words[w] & other.words[w];
+		return acc != 0;
+	}
+
+	// Calls f(index) for every set bit in increasing order
+	template <class F>
+	void for_each(F f) const
+	{
+		for (int w = 0; w < WORDS; w++)
+		{
+			uint64_t bits = words[w];
+			while (bits)
+			{
+				f((w << 6) + bit_scan_forward(bits));
+				bits &= bits - 1;
+			}
+		}
+	}
+
+	BasicBitboard &operator&=(const BasicBitboard &other)
+	{
+		for (int w = 0; w < WORDS; w++) words[w] &= other.words[w];
+		return *this;
+	}
+
+	BasicBitboard &operator|=(const BasicBitboard &other)
+	{
+		for (int w = 0; w < WORDS; w++) words[w] |= other.words[w];
+		return *this;
+	}
+
+	BasicBitboard &operator^=(const BasicBitboard &other)
+	{
+		for (int w = 0; w < WORDS; w++) words[w] ^= other.words[w];
+		return *this;
+	}
+
+	// Removes every bit of other from this set
+	BasicBitboard &clear(const BasicBitboard &other)
+	{
+		for (int w = 0; w < WORDS; w++) words[w] &= ~other.words[w];
+		return *this;
+	}
+
+	// Moves bit i to bit i + k
+	BasicBitboard shifted_up(int k) const
+	{
+		BasicBitboard result;
+		const int word_shift = k >> 6;
+		const int bit_shift = k & 63;
+		for (int w = WORDS - 1; w >= word_shift; w--)
+		{
+			uint64_t value = words[w - word_shift] << bit_shift;
+			if (bit_shift && w - word_shift > 0)
+			{
+				value |= words[w - word_shift - 1] >> (64 - bit_shift);
+			}
+			result.words[w] = value;
+		}
+		return result;
+	}
+
+	// Moves bit i to bit i - k
+	BasicBitboard shifted_down(int k) const
+	{
+		BasicBitboard result;
+		const int word_shift = k >> 6;
+		const int bit_shift = k & 63;
+		for (int w = 0; w + word_shift < WORDS; w++)
+		{
+			uint64_t value = words[w + word_shift] >> bit_shift;
+			if (bit_shift && w + word_shift + 1 < WORDS)
+			{
+				value |= words[w + word_shift + 1] << (64 - bit_shift);
+			}
+			result.words[w] = value;
+		}
+		return result;
+	}
+
+	bool operator==(const BasicBitboard &other) const
+	{
+		uint64_t acc = 0;
+		for (int w = 0; w < WORDS; w++) acc |= words[w] ^ other.words[w];
+		return acc == 0;
+	}
+	inline bool operator!=(const BasicBitboard &other) const { return !(*this == other); }
+
+private:
+	uint64_t words[WORDS];
+};
+
+template <int Words>
+inline BasicBitboard<Words> operator&(BasicBitboard<Words> a, const BasicBitboard<Words> &b) { return a &= b; }
+template <int Words>
+inline BasicBitboard<Words> operator|(BasicBitboard<Words> a, const BasicBitboard<Words> &b) { return a |= b; }
+template <int Words>
+inline BasicBitboard<Words> operator^(BasicBitboard<Words> a, const BasicBitboard<Words> &b) { return a ^= b; }
+
+// Large enough for any board up to 19x19
+typedef BasicBitboard<(19 * 19 + 63) / 64> Bitboard;
+
+// The smallest bitboard that holds an NxN board, N = 0 means any size
+template <int N>
+struct BoardBits
+{
+	typedef BasicBitboard<N == 0 ? Bitboard::WORDS : (N * N + 63) / 64> type;
+};
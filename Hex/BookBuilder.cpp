@@ -0,0 +1,244 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "BookBuilder.h"
+#include "HexBoard.h"
+#include "OpeningBook.h"
+#include "ParallelSearch.h"
+#include "TranspositionTable.h"
+using namespace std;
+
+static const char *const USAGE =
+	"Hex book [key=value ...]\n"
+	"  size=8 plies=3 depth=5 time=0 threads=<cores> table=64 out=book<size>.bin\n"
+	"  eval=longest|shortest|two-distance|resistance|patterns\n";
+
+static const char *const EVALUATOR_NAMES[] = { "longest", "shortest", "two-distance", "resistance", "patterns" };
+
+// Flags of the colors whose book can lead to a position
+static const int RED_BOOK = 1 << HexGame::RED;
+static const int BLUE_BOOK = 1 << HexGame::BLUE;
+
+BookSettings::BookSettings()
+{
+	const int cores = (int)thread::hardware_concurrency();
+	size = 8;
+	plies = 3;
+	max_depth = 5;
+	move_time_ms = 0;
+	threads = cores > 0 ? cores : 1;
+	table_megabytes = 64;
+	evaluator = HexGame::TWO_DISTANCE;
+}
+
+// A position of a level, as the moves that lead to it, RED first
+struct book_position
+{
+	vector<int> moves;
+	int books;
+};
+
+template <int N>
+static void build(const BookSettings &settings)
+{
+	const HexBoard<N> empty(settings.size);
+	const int cells = empty.tables().cell_count();
+	vector<OpeningBook::Entry> entries;
+
+	map<uint64_t, book_position> level;
+	bool rotated;
+	level[empty.canonical_hash(HexGame::RED, rotated)] = { vector<int>(), RED_BOOK | BLUE_BOOK };
+
+	for (int stones = 0; stones < settings.plies && stones < cells && !level.empty(); stones++)
+	{
+		const HexGame::Player to_move = stones % 2 == 0 ? HexGame::RED : HexGame::BLUE;
+		const HexGame::Player opponent = to_move == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+		vector<book_position> positions;
+		for (const auto &keyed : level)
+		{
+			positions.push_back(keyed.second);
+		}
+		const auto start = chrono::steady_clock::now();
+
+		// Positions where the side to move has the book get searched, on a pool
+		// of threads with a table each, since their positions hardly overlap
+		vector<OpeningBook::Entry> found(positions.size());
+		atomic<size_t> next(0);
+		auto worker = [&]()
+		{
+			TranspositionTable table(settings.table_megabytes);
+			for (size_t i = next++; i < positions.size(); i = next++)
+			{
+				found[i].move = -1;
+				if ((positions[i].books & (1 << to_move)) == 0)
+				{
+					continue;
+				}
+				HexBoard<N> board(settings.size);
+				board.set_evaluator(settings.evaluator);
+				HexGame::Player player = HexGame::RED;
+				for (int cell : positions[i].moves)
+				{
+					board.make_index(player, cell / settings.size, cell % settings.size);
+					player = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+				}
+				if (board.check_winner() != HexGame::BLANK)
+				{
+					continue;
+				}
+				const pair<int, int> last = positions[i].moves.empty() ? make_pair(-1, -1)
+					: make_pair(positions[i].moves.back() / settings.size, positions[i].moves.back() % settings.size);
+				table.new_search();
+				ParallelSearch<N> search(board, &table, 1);
+				const ai_move best = search.iterative_deepening(to_move, last, settings.move_time_ms, settings.max_depth);
+				const int cell = best.x * settings.size + best.y;
+
+				bool turned;
+				found[i].key = board.canonical_hash(to_move, turned);
+				found[i].move = (int16_t)(turned ? cells - 1 - cell : cell);
+				found[i].depth = (int16_t)search.completed_depth();
+				found[i].score = best.score;
+			}
+		};
+		vector<thread> workers;
+		for (int t = 1; t < settings.threads && t < (int)positions.size(); t++)
+		{
+			workers.emplace_back(worker);
+		}
+		worker();
+		for (thread &t : workers)
+		{
+			t.join();
+		}
+
+		// The next level: the book move where the side to move has the book,
+		// every move for the other side's book
+		map<uint64_t, book_position> next_level;
+		int searched = 0;
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			const book_position &position = positions[i];
+			HexBoard<N> board(settings.size);
+			HexGame::Player player = HexGame::RED;
+			for (int cell : position.moves)
+			{
+				board.make_index(player, cell / settings.size, cell % settings.size);
+				player = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+			}
+			if (board.check_winner() != HexGame::BLANK)
+			{
+				continue;
+			}
+
+			auto add_child = [&](int cell, int books)
+			{
+				board.make_index(to_move, cell);
+				book_position &child = next_level[board.canonical_hash(opponent, rotated)];
+				if (child.books == 0)
+				{
+					child.moves = position.moves;
+					child.moves.push_back(cell);
+				}
+				child.books |= books;
+				board.unmake_index();
+			};
+
+			if (found[i].move >= 0)
+			{
+				searched++;
+				entries.push_back(found[i]);
+
+				// The stored move is for the canonical orientation, play it on this one
+				bool turned;
+				board.canonical_hash(to_move, turned);
+				add_child(turned ? cells - 1 - found[i].move : found[i].move, 1 << to_move);
+			}
+			if (position.books & (1 << opponent))
+			{
+				for (int cell = 0; cell < cells; cell++)
+				{
+					if (board.get_node_value(cell) == HexGame::BLANK)
+					{
+						add_child(cell, 1 << opponent);
+					}
+				}
+			}
+		}
+		level.swap(next_level);
+
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << stones << " stones: " << positions.size() << " positions, " << searched << " searched in " << seconds << " s" << endl;
+	}
+
+	OpeningBook::write(settings.path, settings.size, entries);
+	cout << entries.size() << " entries written to " << settings.path << endl;
+}
+
+void build_opening_book(const BookSettings &settings)
+{
+	switch (settings.size)
+	{
+#define BUILD(N) case N: build<N>(settings); break;
+	HEX_FIXED_SIZES(BUILD)
+#undef BUILD
+	default:
+		build<0>(settings);
+	}
+}
+
+int run_book_builder(int argc, char *argv[])
+{
+	BookSettings settings;
+	for (int i = 0; i < argc; i++)
+	{
+		const string argument = argv[i];
+		const size_t equals = argument.find('=');
+		const string key = argument.substr(0, equals);
+		const string value = equals == string::npos ? "" : argument.substr(equals + 1);
+		int evaluator = -1;
+		for (int e = 0; e < 5; e++)
+		{
+			if (value == EVALUATOR_NAMES[e]) evaluator = e;
+		}
+
+		if (key == "size") settings.size = atoi(value.c_str());
+		else if (key == "plies") settings.plies = atoi(value.c_str());
+		else if (key == "depth") settings.max_depth = atoi(value.c_str());
+		else if (key == "time") settings.move_time_ms = atoi(value.c_str());
+		else if (key == "threads") settings.threads = atoi(value.c_str());
+		else if (key == "table") settings.table_megabytes = strtoul(value.c_str(), nullptr, 10);
+		else if (key == "out") settings.path = value;
+		else if (key == "eval" && evaluator >= 0) settings.evaluator = (HexGame::Evaluator)evaluator;
+		else
+		{
+			cerr << "Unknown book setting " << argument << "\n" << USAGE;
+			return 1;
+		}
+	}
+	if (settings.max_depth <= 0 && settings.move_time_ms <= 0)
+	{
+		cerr << "The book needs a depth or a time per position\n" << USAGE;
+		return 1;
+	}
+	if (settings.path.empty())
+	{
+		settings.path = "book" + to_string(settings.size) + ".bin";
+	}
+
+	try
+	{
+		build_opening_book(settings);
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include "HexGame.h"
+
+struct BookSettings
+{
+	BookSettings();
+
+	int size;
+	int plies;         // positions with fewer stones than this get a book move
+	int max_depth;     // search depth per position, 0 for no limit
+	int move_time_ms;  // search time per position, 0 for no limit
+	int threads;       // positions searched at the same time
+	size_t table_megabytes;
+	HexGame::Evaluator evaluator;
+	std::string path;
+};
+
+// Builds an opening book offline by searching every position the book can
+// meet: the side that has the book plays the book move, the other side plays
+// anything. That is done for both colors, level by level from the empty board.
+// Positions and their 180 degree rotations are searched once.
+void build_opening_book(const BookSettings &settings);
+
+// Hex book [key=value ...], see the usage text in BookBuilder.cpp
+int run_book_builder(int argc, char *argv[]);
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cmath>
+#include "ConnectionEvaluator.h"
+using namespace std;
+
+// Sources of a distance offer that are not cells
+static const int NO_SOURCE = -1;
+static const int EDGE_SOURCE = -2;
+
+// Own stones are not quite wires, so the matrix stays well conditioned
+static const double OWN_RESISTANCE = 0.01;
+
+// Every node leaks a little current to ground, which keeps the matrix positive
+// definite when blank pockets are walled off from both edges
+static const double LEAK = 1e-9;
+
+// No real path has a resistance anywhere near this, only the leak carries
+// current when the edges are cut off from each other
+static const double CUT_OFF = 1e6;
+
+template <int N>
+ConnectionEvaluator<N>::ConnectionEvaluator() : cells(0), group_total(0)
+{
+}
+
+template <int N>
+void ConnectionEvaluator<N>::prepare(const Geometry &geometry)
+{
+	if (cells == geometry.cell_count())
+	{
+		return;
+	}
+	cells = geometry.cell_count();
+	group_of.resize(cells);
+	group_border.resize(cells);
+	group_visit.resize(cells);
+	first_source.resize(cells);
+	bucket_head.resize(cells + 2);
+	next_queued.resize(cells);
+	from_start.resize(cells);
+	from_goal.resize(cells);
+	band.resize((size_t)cells * (geometry.V() + 1));
+	voltage.resize(cells);
+}
+
+template <int N>
+int ConnectionEvaluator<N>::shortest_path(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal)
+{
+	Bits blank = geometry.all_cells;
+	blank.clear(own);
+	blank.clear(opponent);
+
+	Bits reached = geometry.flood_fill(start & own, own);
+	for (int distance = 0; ; distance++)
+	{
+		if (reached.intersects(goal))
+		{
+			return distance;
+		}
+
+		// The blank cells one more step out are the ones on the start edge or next
+		// to what is reached, and they pass that on to every own stone they touch
+		Bits step = geometry.dilate(reached);
+		step |= start;
+		step &= blank;
+		step.clear(reached);
+		if (step.none())
+		{
+			return unreachable(geometry);
+		}
+		Bits region = step | own;
+		region.clear(reached);
+		reached |= geometry.flood_fill(step, region);
+	}
+}
+
+template <int N>
+void ConnectionEvaluator<N>::distances_from(const Geometry &geometry, const Bits &own, const Bits &blank, const Bits &start, vector<int> &distance)
+{
+	fill(distance.begin(), distance.end(), unreachable(geometry));
+	Bits reached = geometry.flood_fill(start & own, own);
+	for (int steps = 1; ; steps++)
+	{
+		Bits step = geometry.dilate(reached);
+		step |= start;
+		step &= blank;
+		step.clear(reached);
+		if (step.none())
+		{
+			return;
+		}
+		step.for_each([&](int cell) { distance[cell] = steps; });
+		Bits region = step | own;
+		region.clear(reached);
+		reached |= geometry.flood_fill(step, region);
+	}
+}
+
+template <int N>
+int ConnectionEvaluator<N>::shortest_paths_through(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal, int *through)
+{
+	prepare(geometry);
+	Bits blank = geometry.all_cells;
+	blank.clear(own);
+	blank.clear(opponent);
+	if (geometry.flood_fill(start & own, own).intersects(goal))
+	{
+		return 0;
+	}
+
+	distances_from(geometry, own, blank, start, from_start);
+	distances_from(geometry, own, blank, goal, from_goal);
+	const int worst = unreachable(geometry);
+	int shortest = worst;
+	blank.for_each([&](int cell)
+	{
+		// The cell is counted from both sides
+		through[cell] = from_start[cell] < worst && from_goal[cell] < worst ? from_start[cell] + from_goal[cell] - 1 : worst;
+		shortest = min(shortest, through[cell]);
+	});
+	return shortest;
+}
+
+template <int N>
+void ConnectionEvaluator<N>::find_groups(const Geometry &geometry, const Bits &own, const Bits &blank)
+{
+	fill(group_of.begin(), group_of.end(), -1);
+	group_total = 0;
+	Bits remaining = own;
+	while (remaining.any())
+	{
+		Bits seed;
+		seed.set(remaining.first());
+		const Bits group = geometry.flood_fill(seed, own);
+		remaining.clear(group);
+		group_border[group_total] = geometry.dilate(group) & blank;
+		group_visit[group_total] = NO_SOURCE;
+		group.for_each([&](int cell) { group_of[cell] = group_total; });
+		group_total++;
+	}
+}
+
+template <int N>
+void ConnectionEvaluator<N>::push(int cell, int value)
+{
+	queued.set(cell);
+	next_queued[cell] = bucket_head[value];
+	bucket_head[value] = cell;
+}
+
+// Offers are made in order of distance, so a cell's distance is settled by the
+// second offer from a different source. The edge counts as both.
+template <int N>
+void ConnectionEvaluator<N>::receive(int cell, int value, int source)
+{
+	if (queued.test(cell))
+	{
+		return;
+	}
+	if (source == EDGE_SOURCE)
+	{
+		push(cell, value + 1);
+	}
+	else if (first_source[cell] == NO_SOURCE)
+	{
+		first_source[cell] = source;
+	}
+	else if (first_source[cell] != source)
+	{
+		push(cell, value + 1);
+	}
+}
+
+template <int N>
+int ConnectionEvaluator<N>::two_distance(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal)
+{
+	prepare(geometry);
+	Bits blank = geometry.all_cells;
+	blank.clear(own);
+	blank.clear(opponent);
+
+	const Bits start_chains = geometry.flood_fill(start & own, own);
+	if (start_chains.intersects(goal))
+	{
+		return 0;
+	}
+	find_groups(geometry, own, blank);
+	fill(first_source.begin(), first_source.end(), NO_SOURCE);
+	fill(bucket_head.begin(), bucket_head.end(), -1);
+	queued = Bits();
+
+	// Blank cells on an edge or around a group of stones on that edge touch it
+	Bits start_side = geometry.dilate(start_chains) | start;
+	start_side &= blank;
+	Bits goal_side = geometry.dilate(geometry.flood_fill(goal & own, own)) | goal;
+	goal_side &= blank;
+
+	start_side.for_each([&](int cell) { receive(cell, 0, EDGE_SOURCE); });
+
+	for (int value = 1; value <= cells; value++)
+	{
+		// Offers from this bucket settle cells one further out, never this one
+		for (int cell = bucket_head[value]; cell >= 0; cell = next_queued[cell])
+		{
+			if (goal_side.test(cell))
+			{
+				return value;
+			}
+			for (int neighbor : geometry.neighbors(cell))
+			{
+				if (blank.test(neighbor))
+				{
+					receive(neighbor, value, cell);
+				}
+				else if (own.test(neighbor))
+				{
+					const int group = group_of[neighbor];
+					if (group_visit[group] != cell)
+					{
+						group_visit[group] = cell;
+						group_border[group].for_each([&](int across) { receive(across, value, cell); });
+					}
+				}
+			}
+		}
+	}
+	return unreachable(geometry);
+}
+
+template <int N>
+double ConnectionEvaluator<N>::resistance(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal)
+{
+	prepare(geometry);
+	const int n = geometry.V();
+	const int width = n + 1;
+
+	// band[i * width + (i - j)] holds entry (i, j) of the lower triangle
+	fill(band.begin(), band.end(), 0.0);
+	fill(voltage.begin(), voltage.end(), 0.0);
+	for (int cell = 0; cell < cells; cell++)
+	{
+		double *row = &band[(size_t)cell * width];
+		if (opponent.test(cell))
+		{
+			row[0] = 1.0;
+			continue;
+		}
+
+		const double own_resistance = own.test(cell) ? OWN_RESISTANCE : 1.0;
+		double diagonal = LEAK;
+		for (int neighbor : geometry.neighbors(cell))
+		{
+			if (opponent.test(neighbor))
+			{
+				continue;
+			}
+			const double conductance = 1.0 / (own_resistance + (own.test(neighbor) ? OWN_RESISTANCE : 1.0));
+			diagonal += conductance;
+			if (neighbor < cell)
+			{
+				row[cell - neighbor] = -conductance;
+			}
+		}
+
+		// The start edge is held at 1 volt and the goal edge at 0
+		if (start.test(cell))
+		{
+			diagonal += 1.0 / own_resistance;
+			voltage[cell] = 1.0 / own_resistance;
+		}
+		if (goal.test(cell))
+		{
+			diagonal += 1.0 / own_resistance;
+		}
+		row[0] = diagonal;
+	}
+
+	// Cholesky factorization in place, then the two triangular solves
+	for (int i = 0; i < cells; i++)
+	{
+		const int low = i - n > 0 ? i - n : 0;
+		for (int j = low; j <= i; j++)
+		{
+			double sum = band[(size_t)i * width + (i - j)];
+			for (int k = low; k < j; k++)
+			{
+				sum -= band[(size_t)i * width + (i - k)] * band[(size_t)j * width + (j - k)];
+			}
+			if (j == i)
+			{
+				band[(size_t)i * width] = sqrt(sum > LEAK ? sum : LEAK);
+			}
+			else
+			{
+				band[(size_t)i * width + (i - j)] = sum / band[(size_t)j * width];
+			}
+		}
+	}
+	for (int i = 0; i < cells; i++)
+	{
+		const int low = i - n > 0 ? i - n : 0;
+		double sum = voltage[i];
+		for (int k = low; k < i; k++)
+		{
+			sum -= band[(size_t)i * width + (i - k)] * voltage[k];
+		}
+		voltage[i] = sum / band[(size_t)i * width];
+	}
+	for (int i = cells - 1; i >= 0; i--)
+	{
+		const int high = i + n < cells - 1 ? i + n : cells - 1;
+		double sum = voltage[i];
+		for (int k = i + 1; k <= high; k++)
+		{
+			sum -= band[(size_t)k * width + (k - i)] * voltage[k];
+		}
+		voltage[i] = sum / band[(size_t)i * width];
+	}
+
+	// One volt over the circuit, so the resistance is one over the current
+	double current = 0.0;
+	start.for_each([&](int cell)
+	{
+		if (!opponent.test(cell))
+		{
+			current += (1.0 - voltage[cell]) / (own.test(cell) ? OWN_RESISTANCE : 1.0);
+		}
+	});
+	return current > 1.0 / CUT_OFF ? 1.0 / current : CUT_OFF;
+}
+
+#define INSTANTIATE(N) template class ConnectionEvaluator<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
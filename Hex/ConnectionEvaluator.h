@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "Bitboard.h"
+#include "HexGeometry.h"
+
+// Measures how close a player is to joining their two edges. Every method takes
+// the player's own stones, the opponent's stones and the two edges to join, and
+// works in buffers that are sized on the first call and reused after that, so
+// evaluating a position never allocates.
+//
+// One evaluator must not be used by two threads at once. Every HexBoard owns one,
+// and every search thread works on its own board.
+template <int N>
+class ConnectionEvaluator
+{
+public:
+	typedef HexGeometry<N> Geometry;
+	typedef typename Geometry::Bits Bits;
+
+	ConnectionEvaluator();
+
+	// Distance that means the player can no longer connect at all
+	inline static int unreachable(const Geometry &geometry) { return geometry.cell_count() + 1; };
+
+	// The fewest blank cells the player still has to fill to connect, 0 once
+	// they have. Own stones cost nothing to pass through and opponent stones
+	// can't be passed. This is a 0-1 BFS done one distance at a time on bit
+	// sets: every level adds the blank cells next to the previous levels and
+	// then everything those reach through own stones.
+	int shortest_path(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal);
+
+	// The shortest_path() of the player, and for every blank cell the length
+	// of the shortest path that goes through it in through[cell], or
+	// unreachable() when no path does. Cells that are not blank are left alone.
+	// Takes the same two searches as shortest_path(), once from each edge.
+	int shortest_paths_through(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal, int *through);
+
+	// Like shortest_path(), but a blank cell is only as close as its second
+	// closest neighbor plus one, since the opponent can always block the best
+	// one. Groups of own stones are contracted, so every blank cell around a
+	// group is a neighbor of every other one. Cells touching the start edge are
+	// at distance 1.
+	int two_distance(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal);
+
+	// Resistance between the two edges when blank cells are unit resistors, own
+	// stones are nearly wires and opponent stones are cut out. Many parallel
+	// routes lower it, not just the single best one. The circuit is solved
+	// exactly with a banded Cholesky factorization, since row major order keeps
+	// every neighbor within n places of a cell. Returns a huge value when the
+	// edges are cut off from each other.
+	double resistance(const Geometry &geometry, const Bits &own, const Bits &opponent, const Bits &start, const Bits &goal);
+
+private:
+	void prepare(const Geometry &geometry);
+	void distances_from(const Geometry &geometry, const Bits &own, const Bits &blank, const Bits &start, std::vector<int> &distance);
+	void find_groups(const Geometry &geometry, const Bits &own, const Bits &blank);
+	void receive(int cell, int value, int source);
+	void push(int cell, int value);
+
+	int cells;
+
+	// Own stone groups for two_distance(): the group of every own cell
+	// (-1 for others), the blank cells around every group, and the last cell
+	// that passed its distance on through the group
+	std::vector<int> group_of;
+	std::vector<Bits> group_border;
+	std::vector<int> group_visit;
+	int group_total;
+
+	// The cell that first offered each blank cell a distance, and a bucket
+	// queue of cells whose distance is known, linked through next_queued
+	std::vector<int> first_source;
+	std::vector<int> bucket_head;
+	std::vector<int> next_queued;
+	Bits queued;
+
+	// Blank cells needed to reach each blank cell from either edge, counting
+	// the cell, for shortest_paths_through()
+	std::vector<int> from_start;
+	std::vector<int> from_goal;
+
+	// Lower band of the conductance matrix for resistance(), n + 1 entries per
+	// row, and the voltages being solved for
+	std::vector<double> band;
+	std::vector<double> voltage;
+};
@@ -0,0 +1,685 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "HexBoard.h"
+#include "MctsSearch.h"
+#include "OpeningBook.h"
+#include "ParallelSearch.h"
+using namespace std;
+
+// Owned by the board that started it. Stopping sets the flag the search looks
+// at every 1024 nodes and waits for the thread, which takes a few milliseconds.
+template <int N>
+struct HexBoard<N>::ponder_task
+{
+	explicit ponder_task(const HexBoard<N> &board) : board(board), stop(false) {}
+	~ponder_task()
+	{
+		stop.store(true, memory_order_relaxed);
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	HexBoard<N> board;
+	atomic<bool> stop;
+	thread worker;
+	ponder_result result;
+};
+
+template <int N>
+HexBoard<N>::HexBoard(int n) : geometry(make_shared<const Geometry>(n)), n(n)
+{
+	// Creates an NxN hexboard, both bit sets start out empty so every cell is blank.
+	// The geometry has checked n by now.
+	connections = UnionFind(n * n + 4);
+	placements.reserve(n * n);
+	size_cells(blanks, n * n);
+	size_cells(blank_slot, n * n);
+	rebuild();
+
+	current_cord = make_pair(0, 0);
+	info = search_info();
+	table_megabytes = 16;
+	move_time_ms = 1000;
+	max_depth = 0;
+	search_threads = 1;
+	engine = MINIMAX;
+	playout_budget = 0;
+	evaluator = TWO_DISTANCE;
+	pattern_weights = PatternWeights::builtin();
+	prune_inferior = true;
+	pondering = false;
+	pondered = ponder_result();
+}
+
+template <int N>
+void HexBoard<N>::make_index(Player player, int row, int col)
+{
+	if (row < V() && row >= 0 && col < V() && col >= 0)
+	{
+		const int index = index_of(row, col);
+		const Player current = get_node_value(index);
+		if (current == player)
+		{
+			return;
+		}
+		if (current != BLANK)
+		{
+			remove_stone(index);
+		}
+		if (player != BLANK)
+		{
+			make_index(player, index);
+			current_cord = make_pair(row, col);
+		}
+	}
+}
+
+template <int N>
+void HexBoard<N>::make_index(Player player, int index)
+{
+	placements.push_back({ index, connections.checkpoint(), take_blank(index) });
+	player_stones[player].set(index);
+	position_hash ^= geometry->zobrist(player, index);
+	connect(index, player);
+}
+
+template <int N>
+void HexBoard<N>::unmake_index()
+{
+	const placement last = placements.back();
+	placements.pop_back();
+	connections.rollback(last.checkpoint);
+	return_blank(last.index, last.blank_slot);
+	position_hash ^= geometry->zobrist(get_node_value(last.index), last.index);
+	player_stones[RED].reset(last.index);
+	player_stones[BLUE].reset(last.index);
+}
+
+// Joins a new stone to the neighboring stones of its color and to its edges
+template <int N>
+void HexBoard<N>::connect(int index, Player player)
+{
+	const Geometry &g = *geometry;
+	for (int neighbor : g.neighbors(index))
+	{
+		if (player_stones[player].test(neighbor))
+		{
+			connections.unite(index, neighbor);
+		}
+	}
+
+	const int edges = g.cell_count();
+	const int on_edges = g.edges(index);
+	if (player == RED)
+	{
+		if (on_edges & NORTH_EDGE) connections.unite(index, edges + NORTH);
+		if (on_edges & SOUTH_EDGE) connections.unite(index, edges + SOUTH);
+	}
+	else
+	{
+		if (on_edges & WEST_EDGE) connections.unite(index, edges + WEST);
+		if (on_edges & EAST_EDGE) connections.unite(index, edges + EAST);
+	}
+}
+
+// Swaps index with the last blank cell and shrinks the blank part of the list
+// past it. Returns the slot index used to have so the swap can be reversed.
+template <int N>
+int HexBoard<N>::take_blank(int index)
+{
+	const int slot = blank_slot[index];
+	const int last = blanks[--blank_total];
+	blanks[slot] = last;
+	blank_slot[last] = slot;
+	blanks[blank_total] = index;
+	blank_slot[index] = blank_total;
+	return slot;
+}
+
+// Exact reverse of take_blank(), index must be the most recently taken cell
+template <int N>
+void HexBoard<N>::return_blank(int index, int slot)
+{
+	const int moved = blanks[slot];
+	blanks[slot] = index;
+	blank_slot[index] = slot;
+	blanks[blank_total] = moved;
+	blank_slot[moved] = blank_total;
+	blank_total++;
+}
+
+template <int N>
+void HexBoard<N>::remove_stone(int index)
+{
+	if (placements.back().index == index)
+	{
+		unmake_index();
+		return;
+	}
+
+	// An older stone is being taken away, which the undo logs can't express.
+	// Drop it and replay the remaining stones from an empty board.
+	for (unsigned int i = 0; i < placements.size(); i++)
+	{
+		if (placements[i].index == index)
+		{
+			placements.erase(placements.begin() + i);
+			break;
+		}
+	}
+	player_stones[RED].reset(index);
+	player_stones[BLUE].reset(index);
+	rebuild();
+}
+
+template <int N>
+void HexBoard<N>::rebuild()
+{
+	connections.reset();
+	position_hash = 0;
+	blank_total = V() * V();
+	for (int i = 0; i < blank_total; i++)
+	{
+		blanks[i] = i;
+		blank_slot[i] = i;
+	}
+
+	for (placement &p : placements)
+	{
+		p.checkpoint = connections.checkpoint();
+		p.blank_slot = take_blank(p.index);
+		position_hash ^= geometry->zobrist(get_node_value(p.index), p.index);
+		connect(p.index, get_node_value(p.index));
+	}
+}
+
+// Min neighbors is 2 max is 6, off board coordinates have none
+template <int N>
+const NeighborList &HexBoard<N>::legal_neighbors(int row, int col) const
+{
+	static const NeighborList no_neighbors = {};
+	if (row >= 0 && row < V() && col >= 0 && col < V())
+	{
+		return geometry->neighbors(index_of(row, col));
+	}
+	return no_neighbors;
+}
+
+template <int N>
+typename HexBoard<N>::Player HexBoard<N>::get_node_value(int row, int col) const
+{
+	return get_node_value(index_of(row, col));
+}
+
+template <int N>
+typename HexBoard<N>::Player HexBoard<N>::get_node_value(pair<int, int> p) const
+{
+	return get_node_value(p.first, p.second);
+}
+
+template <int N>
+typename HexBoard<N>::Player HexBoard<N>::get_node_value(int index) const
+{
+	if (player_stones[RED].test(index)) return RED;
+	if (player_stones[BLUE].test(index)) return BLUE;
+	return BLANK;
+}
+
+template <int N>
+typename HexBoard<N>::Bits HexBoard<N>::blank_cells() const
+{
+	Bits blanks = geometry->all_cells;
+	blanks.clear(player_stones[RED]);
+	return blanks.clear(player_stones[BLUE]);
+}
+
+// The edges are kept in the same sets as the stones touching them,
+// so a winner is a player whose two edges share a set
+template <int N>
+typename HexBoard<N>::Player HexBoard<N>::check_winner() const
+{
+	const int edges = geometry->cell_count();
+	if (connections.same(edges + NORTH, edges + SOUTH))
+	{
+		return RED;
+	}
+	if (connections.same(edges + WEST, edges + EAST))
+	{
+		return BLUE;
+	}
+	return BLANK;
+}
+
+// This function takes the true sublength of the hex_board
+// If a sub-length is becoming large towards the direction of that player's win condition
+// The longest_sub length will be updated.
+template <int N>
+int HexBoard<N>::longest_sub_length(Player player) const
+{
+	const Geometry &g = *geometry;
+	Bits remaining = player_stones[player];
+	int longest = 0;
+
+	while (remaining.any())
+	{
+		// Split off the group connected to the lowest remaining stone
+		Bits seed;
+		seed.set(remaining.first());
+		Bits group = g.flood_fill(seed, remaining);
+		remaining.clear(group);
+
+		int lowest, highest;
+		if (player == RED)
+		{
+			// Bits are row major, so the first and last bits give the row span
+			lowest = group.first() / V();
+			highest = group.last() / V();
+		}
+		else
+		{
+			lowest = 0;
+			while (!group.intersects(g.col_masks[lowest])) lowest++;
+			highest = V() - 1;
+			while (!group.intersects(g.col_masks[highest])) highest--;
+		}
+
+		int length = highest - lowest + 1;
+		longest = longest > length ? longest : length;
+	}
+	return longest;
+}
+
+// Calculates the next move for the AI player
+template <int N>
+void HexBoard<N>::next_move()
+{
+	const ai_move best_move = find_move(BLUE);
+	if (info.book_move)
+	{
+		cout << "Blue moving at (" << best_move.x << ", " << best_move.y << ") from the book, score = " << best_move.score
+			<< " at depth " << info.depth << endl;
+	}
+	else if (engine == MCTS)
+	{
+		cout << "Blue moving at (" << best_move.x << ", " << best_move.y << ") win chance = " << best_move.score << "%" << endl;
+		cout << info.nodes << " playouts, " << info.tree_nodes << " tree nodes" << endl;
+	}
+	else
+	{
+		cout << "Blue moving at (" << best_move.x << ", " << best_move.y << ") score = " << best_move.score << endl;
+		if (info.ponder_nodes > 0)
+		{
+			cout << "Pondered to depth " << info.ponder_depth << ", " << info.ponder_nodes << " nodes, "
+				<< (info.ponder_hit ? "guessed the reply" : "missed the reply") << endl;
+		}
+		cout << "Searched to depth " << info.depth << ", " << info.nodes << " nodes" << endl;
+		if (table)
+		{
+			cout << "Transposition table: " << info.table_probes << " probes, " << (int)(info.table_hit_rate * 100 + 0.5) << "% hits" << endl;
+		}
+	}
+
+	make_index(BLUE, best_move.x, best_move.y);
+}
+
+// Uses minimax with iterative deepening or MCTS, depending on the engine.
+template <int N>
+ai_move HexBoard<N>::find_move(Player player)
+{
+	stop_pondering();
+	info = search_info();
+	info.ponder_depth = pondered.depth;
+	info.ponder_nodes = pondered.nodes;
+	info.ponder_hit = pondered.depth > 0 && pondered.hash == hash() && pondered.player == player;
+	const ponder_result ponder_hit = pondered;
+	pondered = ponder_result();
+	stats.clear();
+
+	// The book was searched deeper offline than there is time for now
+	if (book)
+	{
+		bool rotated;
+		const OpeningBook::Entry *entry = book->find(canonical_hash(player, rotated));
+		const int cell = entry ? (rotated ? geometry->cell_count() - 1 - entry->move : entry->move) : -1;
+		if (cell >= 0 && cell < geometry->cell_count() && get_node_value(cell) == BLANK)
+		{
+			ai_move move(entry->score);
+			move.x = cell / V();
+			move.y = cell % V();
+			info.book_move = true;
+			info.depth = entry->depth;
+			return move;
+		}
+	}
+
+	if (engine == MCTS)
+	{
+		// The workers play out games on copies, this board is left alone
+		MctsSearch<N> search(*this, search_threads);
+		const ai_move best_move = search.search(player, move_time_ms, playout_budget);
+		info.nodes = search.playouts();
+		info.tree_nodes = search.tree_size();
+		return best_move;
+	}
+
+	if (!table && table_megabytes > 0)
+	{
+		table = make_shared<TranspositionTable>(table_megabytes);
+	}
+	if (table)
+	{
+		table->new_search();
+	}
+
+	// When pondering guessed the reply, the time it spent on this position counts
+	// as time spent on the move. Its results are in the table, so the search
+	// below gets back to where it left off in a fraction of that time.
+	int milliseconds = move_time_ms;
+	if (info.ponder_hit)
+	{
+		if ((max_depth > 0 && ponder_hit.depth >= max_depth) || (move_time_ms > 0 && ponder_hit.milliseconds >= move_time_ms))
+		{
+			info.depth = ponder_hit.depth;
+			return ponder_hit.move;
+		}
+		if (move_time_ms > 0)
+		{
+			milliseconds = move_time_ms - (int)ponder_hit.milliseconds;
+		}
+	}
+
+	// The search plays its moves on this board and takes them back again,
+	// helper threads get copies of it
+	ParallelSearch<N> search(*this, table.get(), search_threads);
+	search.set_stats(&stats);
+	ai_move best_move = search.iterative_deepening(player, current_cord, milliseconds, max_depth);
+	if (HEX_SEARCH_STATS && stats_log)
+	{
+		stats.write_json(*stats_log, V());
+		stats_log->flush();
+	}
+	info.depth = search.completed_depth();
+	info.nodes = search.nodes();
+	if (info.ponder_hit && info.depth < ponder_hit.depth)
+	{
+		// Entries the search needed were replaced, pondering saw further
+		best_move = ponder_hit.move;
+		info.depth = ponder_hit.depth;
+	}
+	if (table)
+	{
+		info.table_probes = table->probes();
+		info.table_hit_rate = table->hit_rate();
+	}
+	return best_move;
+}
+
+template <int N>
+void HexBoard<N>::set_opening_book(const string &path)
+{
+	book.reset();
+	if (!path.empty())
+	{
+		shared_ptr<const OpeningBook> opened = make_shared<const OpeningBook>(path);
+		if (opened->board_size() != V())
+		{
+			throw invalid_argument(path + " is a book for " + to_string(opened->board_size()) + "x" + to_string(opened->board_size()));
+		}
+		book = opened;
+	}
+}
+
+template <int N>
+void HexBoard<N>::set_pondering(bool enabled)
+{
+	stop_pondering();
+	pondering = enabled;
+}
+
+template <int N>
+void HexBoard<N>::start_pondering(Player player)
+{
+	stop_pondering();
+	pondered = ponder_result();
+	if (!pondering || engine != MINIMAX || table_megabytes == 0 || blank_total == 0 || check_winner() != BLANK)
+	{
+		return;
+	}
+	if (!table)
+	{
+		table = make_shared<TranspositionTable>(table_megabytes);
+	}
+	table->new_search();
+
+	// The reply the last search expected is the best move stored for this
+	// position. Pondering plays it and searches for the side after it. Without
+	// a guess it searches this position, which still fills the table with the
+	// positions after every reply, just less deeply.
+	ponder = make_shared<ponder_task>(*this);
+	ponder_task *task = ponder.get();
+	Player searcher = player;
+	TranspositionTable::Entry entry;
+	const uint64_t key = hash() ^ (player == BLUE ? geometry->zobrist_side : 0);
+	if (table->probe(key, entry) && entry.move >= 0 && entry.move < geometry->cell_count() && get_node_value(entry.move) == BLANK)
+	{
+		task->board.make_index(player, entry.move / V(), entry.move % V());
+		if (task->board.check_winner() == BLANK)
+		{
+			searcher = player == RED ? BLUE : RED;
+		}
+		else
+		{
+			task->board.unmake_index();
+		}
+	}
+	task->result.hash = task->board.hash();
+	task->result.player = searcher;
+
+	// The copy shares the table, so what it finds is there for the next search.
+	// With no clock and no depth limit it goes on until it's stopped.
+	const int threads = search_threads;
+	task->worker = thread([task, searcher, threads]()
+	{
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		ParallelSearch<N> search(task->board, task->board.table.get(), threads);
+		search.set_stop_flag(&task->stop);
+		task->result.move = search.iterative_deepening(searcher, task->board.current_cord, 0, 0);
+		task->result.depth = search.completed_depth();
+		task->result.nodes = search.nodes();
+		task->result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	});
+}
+
+template <int N>
+void HexBoard<N>::stop_pondering()
+{
+	if (!ponder)
+	{
+		return;
+	}
+	ponder->stop.store(true, memory_order_relaxed);
+	ponder->worker.join();
+	pondered = ponder->result;
+	ponder.reset();
+}
+
+template <int N>
+void HexBoard<N>::set_stats_log(const string &path)
+{
+	stats_log.reset();
+	if (!path.empty())
+	{
+		stats_log = make_shared<ofstream>(path, ios::app);
+		if (!*stats_log)
+		{
+			stats_log.reset();
+			throw runtime_error("can't write " + path);
+		}
+	}
+}
+
+template <int N>
+void HexBoard<N>::set_table_size(size_t megabytes)
+{
+	table_megabytes = megabytes;
+	table.reset();
+}
+
+template <int N>
+void HexBoard<N>::set_move_time(int milliseconds)
+{
+	move_time_ms = milliseconds;
+}
+
+template <int N>
+void HexBoard<N>::set_max_depth(int depth)
+{
+	max_depth = depth;
+}
+
+template <int N>
+void HexBoard<N>::set_threads(int count)
+{
+	search_threads = count > 1 ? count : 1;
+}
+
+template <int N>
+void HexBoard<N>::set_engine(Engine engine)
+{
+	this->engine = engine;
+}
+
+template <int N>
+void HexBoard<N>::set_playouts(uint64_t playouts)
+{
+	playout_budget = playouts;
+}
+
+template <int N>
+uint64_t HexBoard<N>::canonical_hash(Player to_move, bool &rotated) const
+{
+	const int last = geometry->cell_count() - 1;
+	uint64_t turned = 0;
+	for (int player = RED; player <= BLUE; player++)
+	{
+		player_stones[player].for_each([&](int cell) { turned ^= geometry->zobrist(player, last - cell); });
+	}
+	rotated = turned < position_hash;
+	return (rotated ? turned : position_hash) ^ (to_move == BLUE ? geometry->zobrist_side : 0);
+}
+
+// This is a naive way to get the score from looking at a board state.
+template <int N>
+int HexBoard<N>::get_score(Player player, pair<int, int> cord) const
+{
+	if (cord.first >= 0 && cord.first < V() && cord.second >= 0 && cord.second < V())
+	{
+		return get_score(player, index_of(cord.first, cord.second));
+	}
+	return get_score(player, -1);
+}
+
+template <int N>
+int HexBoard<N>::get_score(Player player, int index) const
+{
+	if (evaluator == PATTERNS)
+	{
+		return patterns.score(*geometry, player_stones[RED], player_stones[BLUE], position_hash, *pattern_weights, player);
+	}
+	if (evaluator != LONGEST_CHAIN)
+	{
+		// RED joins north to south and BLUE joins west to east
+		const Bits &own = player_stones[player];
+		const Bits &other = player_stones[player == RED ? BLUE : RED];
+		const Bits &start = player == RED ? geometry->north_edge : geometry->west_edge;
+		const Bits &goal = player == RED ? geometry->south_edge : geometry->east_edge;
+		const int worst = ConnectionEvaluator<N>::unreachable(*geometry);
+		switch (evaluator)
+		{
+		case SHORTEST_PATH:
+			return worst - connection.shortest_path(*geometry, own, other, start, goal);
+		case TWO_DISTANCE:
+			return worst - connection.two_distance(*geometry, own, other, start, goal);
+		default:
+			// Resistance shrinks by a factor for every extra route, so compare logs
+			return (int)(-100 * log(connection.resistance(*geometry, own, other, start, goal)));
+		}
+	}
+
+	int score = longest_sub_length(player) * 5;
+
+	// Count the player's stones around index with a single masked popcount
+	if (index >= 0)
+	{
+		score += (geometry->neighbor_mask(index) & player_stones[player]).count();
+	}
+
+	return score;
+}
+
+template <int N>
+void HexBoard<N>::set_evaluator(Evaluator evaluator)
+{
+	this->evaluator = evaluator;
+}
+
+template <int N>
+void HexBoard<N>::set_pattern_weights(const string &path)
+{
+	pattern_weights = path.empty() ? PatternWeights::builtin() : PatternWeights::load(path);
+	patterns = PatternEvaluator<N>();
+}
+
+template <int N>
+void HexBoard<N>::print_board() const
+{
+	// This offset is intended to make the visual of the hexboard look more like
+	// what we expect
+	const string indent = " ";
+	string offset = "";
+	for (int i = 0; i < V(); i++)
+	{
+		cout << offset << i << " ";
+		offset += indent;
+		for (int j = 0; j < V(); j++)
+		{
+			Player value = get_node_value(i, j);
+			if (value == RED)
+			{
+				cout << "R";
+			}
+			else if (value == BLUE)
+			{
+				cout << "B";
+			}
+			else if (value == BLANK)
+			{
+				cout << "*";
+			}
+		}
+		cout << endl;
+	}
+}
+
+unique_ptr<HexGame> make_board(int n)
+{
+	switch (n)
+	{
+#define MAKE_BOARD(N) case N: return unique_ptr<HexGame>(new HexBoard<N>());
+	HEX_FIXED_SIZES(MAKE_BOARD)
+#undef MAKE_BOARD
+	default:
+		return unique_ptr<HexGame>(new HexBoard<0>(n));
+	}
+}
+
+#define INSTANTIATE(N) template class HexBoard<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <utility>
+#include "Bitboard.h"
+#include "ConnectionEvaluator.h"
+#include "HexGame.h"
+#include "HexGeometry.h"
+#include "PatternEvaluator.h"
+#include "UnionFind.h"
+
+class OpeningBook;
+class TranspositionTable;
+
+// An NxN hexboard. HexBoard<N> for one of HEX_FIXED_SIZES has its size, its
+// tables and the width of its bit sets fixed at compile time, HexBoard<0> is
+// sized by its constructor. The engines are templates over the same N, so a
+// search on a fixed size board is compiled for that size all the way down.
+template <int N>
+class HexBoard final : public HexGame
+{
+public:
+	typedef HexGeometry<N> Geometry;
+	typedef typename Geometry::Bits Bits;
+
+	explicit HexBoard(int n = N > 0 ? N : 10); // creates an NxN hexboard
+
+	// Push a certain player into an index within the board.
+	void make_index(Player player, int row, int col) override;
+
+	// Fast path for the search, index must be a blank cell and player not BLANK
+	void make_index(Player player, int index);
+
+	// Takes back the most recent stone placed by make_index()
+	void unmake_index();
+
+	// The cells touching (row, col), looked up from a table built with the board
+	const NeighborList &legal_neighbors(int row, int col) const;
+
+	Player check_winner() const override;
+
+	int longest_sub_length(Player player) const;
+
+	// Higher is better for player. Only LONGEST_CHAIN looks at the last move.
+	int get_score(Player player, std::pair<int, int> cord) const;
+	int get_score(Player player, int index) const; // index -1 scores without a last move
+
+	void set_evaluator(Evaluator evaluator) override;
+	void set_pattern_weights(const std::string &path) override;
+	inline void set_pruning(bool enabled) override { prune_inferior = enabled; };
+	inline bool prunes_inferior_cells() const { return prune_inferior; };
+
+	void next_move() override;
+	ai_move find_move(Player player) override;
+	inline const search_info &last_search() const override { return info; };
+	inline const SearchStats &last_stats() const override { return stats; };
+	void set_stats_log(const std::string &path) override;
+
+	void set_opening_book(const std::string &path) override;
+	void set_pondering(bool enabled) override;
+	void start_pondering(Player player) override;
+	void stop_pondering() override;
+
+	void set_table_size(size_t megabytes) override;
+	void set_move_time(int milliseconds) override;
+	void set_max_depth(int depth) override;
+	void set_threads(int count) override;
+	void set_engine(Engine engine) override;
+	void set_playouts(uint64_t playouts) override;
+
+	Player get_node_value(int row, int col) const override;
+	Player get_node_value(std::pair<int, int> p) const;
+	Player get_node_value(int index) const;
+
+	// Bit sets of the cells owned by a player and of the cells nobody owns yet
+	inline const Bits &stones(Player player) const { return player_stones[player]; };
+	Bits blank_cells() const;
+
+	// The blank cells as a list of indices. The order changes as stones are placed,
+	// but unmake_index() always restores the order the list had before.
+	inline const int *blank_list() const { return blanks.data(); };
+	inline int blank_count() const { return blank_total; };
+
+	// Number of stones on the board
+	inline int move_count() const { return (int)placements.size(); };
+
+	// Zobrist hash of the stones on the board, kept up to date by make_index()
+	inline uint64_t hash() const { return position_hash; };
+
+	// The smaller of the hashes of this position and of its 180 degree rotation,
+	// which looks the same to both players, with the side to move mixed in.
+	// rotated tells which one it was, a cell of the rotation is cells - 1 - cell.
+	uint64_t canonical_hash(Player to_move, bool &rotated) const;
+
+	void print_board() const override;
+
+	inline int V() const override { return N > 0 ? N : n; };
+	inline int index_of(int row, int col) const { return row * V() + col; };
+	inline const Geometry &tables() const { return *geometry; };
+private:
+	// Virtual union-find nodes for the board edges, numbered after the cells
+	enum edge_node {NORTH, SOUTH, WEST, EAST};
+
+	struct placement {
+		int index;
+		int checkpoint; // undo log position of connections before the stone went down
+		int blank_slot; // where index sat in the blank list
+	};
+
+	// One bit set per player, indexed by RED and BLUE
+	Bits player_stones[2];
+
+	// Shared between copies, so copying a board never rebuilds the tables
+	std::shared_ptr<const Geometry> geometry;
+
+	// Groups of same colored stones, joined to the edges they touch.
+	// A player has won once their two edges are in the same set.
+	UnionFind connections;
+
+	// Every stone on the board in the order it was placed, used as the undo stack
+	std::vector<placement> placements;
+
+	// The first blank_total entries of blanks are the blank cells, the rest are
+	// the placed stones, and blank_slot maps every cell to its position in blanks
+	CellArray<int, N * N> blanks;
+	CellArray<int, N * N> blank_slot;
+	int blank_total;
+
+	uint64_t position_hash;
+
+	// get_score() is const, but the evaluator keeps its work buffers between calls
+	Evaluator evaluator;
+	mutable ConnectionEvaluator<N> connection;
+	mutable PatternEvaluator<N> patterns;
+	std::shared_ptr<const PatternWeights> pattern_weights; // shared by copies of the board
+	bool prune_inferior;
+
+	void connect(int index, Player player);
+	int take_blank(int index);
+	void return_blank(int index, int slot);
+	void remove_stone(int index);
+	void rebuild();
+
+	// The last stone placed through the public make_index()
+	std::pair<int, int> current_cord;
+	search_info info;
+	SearchStats stats;
+	std::shared_ptr<std::ofstream> stats_log;
+
+	// Created by the first search and kept between moves so later searches
+	// start from what earlier ones learned. Copies of the board share it.
+	std::shared_ptr<TranspositionTable> table;
+	size_t table_megabytes;
+
+	// Mapped once and shared by copies of the board
+	std::shared_ptr<const OpeningBook> book;
+
+	// What the last ponder search found, and for which position and player
+	struct ponder_result {
+		ponder_result() : hash(0), player(BLANK), move(0), depth(0), nodes(0), milliseconds(0.0) {};
+		uint64_t hash;
+		Player player;
+		ai_move move;
+		int depth;
+		uint64_t nodes;
+		double milliseconds;
+	};
+
+	// The search running on the human's time, on a copy of this board
+	struct ponder_task;
+	std::shared_ptr<ponder_task> ponder;
+	ponder_result pondered;
+	bool pondering;
+
+	int move_time_ms;
+	int max_depth;
+	int search_threads;
+	Engine engine;
+	uint64_t playout_budget;
+
+	int n;
+};
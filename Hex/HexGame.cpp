@@ -0,0 +1,91 @@
+#include <cctype>
+#include <iostream>
+#include "HexGame.h"
+using namespace std;
+
+// Starts and runs the game using a simple state machine
+void HexGame::start_game()
+{
+	cout << "Welcome to HEX!\n";
+	cout << "You (the human player) will attempt to go from North to South as the RED player and you will go FIRST\n";
+	cout << "Your enemy is the BLUE player who will attempt to go from West to East\n";
+
+	print_board();
+	game_state current_game_state = PLAYER;
+	while (current_game_state != GAME_OVER) {
+		switch (current_game_state) {
+		case PLAYER:
+			int x, y;
+			cout << "Enter a coordinate please!\n";
+			start_pondering(RED);
+			cin >> x >> y;
+			stop_pondering();
+			if (get_node_value(x, y) != BLANK)
+			{
+				cout << "That index is currently occupied. Skipping your turn.\n";
+			}
+			else {
+				make_index(RED, x, y);
+				print_board();
+			}
+
+			if (check_winner() == BLANK)
+			{
+				cout << "AI TURN IS STARTING!\n";
+				current_game_state = COMPUTER;
+			}
+			else {
+				current_game_state = GAME_OVER;
+			}
+			break;
+
+		case COMPUTER:
+			cout << "BLUE HAS STARTED TO SEARCH!\n";
+			next_move();
+			print_board();
+			cout << "BLUE's SEARCH IS DONE!\n";
+			if (check_winner() == BLANK)
+			{
+				current_game_state = PLAYER;
+			}
+			else {
+				current_game_state = GAME_OVER;
+			}
+			break;
+
+		case GAME_OVER:
+			cout << "Game is Over!\n";
+			print_board();
+			break;
+		}
+	}
+}
+
+string HexGame::cell_name(int row, int col)
+{
+	return string(1, (char)('a' + col)) + to_string(row + 1);
+}
+
+bool HexGame::parse_cell(const string &name, int &row, int &col)
+{
+	if (name.size() < 2 || !islower((unsigned char)name[0]))
+	{
+		return false;
+	}
+	int number = 0;
+	for (size_t i = 1; i < name.size(); i++)
+	{
+		if (!isdigit((unsigned char)name[i]) || number > 1000)
+		{
+			return false;
+		}
+		number = number * 10 + (name[i] - '0');
+	}
+	if (number < 1)
+	{
+		return false;
+	}
+	col = name[0] - 'a';
+	row = number - 1;
+	return true;
+}
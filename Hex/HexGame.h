@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "SearchStats.h"
+
+struct ai_move {
+	ai_move() {};
+	ai_move(int score) : score(score) {};
+	int x;
+	int y;
+	int score;
+};
+
+// What the last search of a board did, for whoever wants to report it
+struct search_info {
+	int depth;             // deepest finished iteration, MINIMAX only
+	uint64_t nodes;        // positions searched, or games played out by MCTS
+	size_t tree_nodes;     // MCTS only
+	uint64_t table_probes; // MINIMAX with a transposition table only
+	double table_hit_rate;
+	int ponder_depth;      // how far pondering got before this search, if it ran
+	uint64_t ponder_nodes;
+	bool ponder_hit;       // pondering searched the position this search started from
+	bool book_move;        // the move came from the opening book, nothing was searched
+};
+
+// The part of a board that doesn't depend on its size: the player facing calls
+// and the settings of the AI. HexBoard<N> implements it for every size, and
+// make_board() picks the fastest HexBoard for a size at run time.
+class HexGame
+{
+public:
+	// Blank player counts as empty space
+	enum Player { RED, BLUE, BLANK };
+
+	// How next_move() picks its move
+	enum Engine { MINIMAX, MCTS };
+
+	// What get_score() measures. LONGEST_CHAIN is the span of the longest group
+	// plus the stones around the last move, PATTERNS adds up weights of the
+	// shapes around every cell (see PatternEvaluator), and the others rate how
+	// close a player is to connecting (see ConnectionEvaluator). TWO_DISTANCE is
+	// the default.
+	enum Evaluator { LONGEST_CHAIN, SHORTEST_PATH, TWO_DISTANCE, RESISTANCE, PATTERNS };
+
+	virtual ~HexGame() {}
+
+	virtual int V() const = 0;
+
+	// Push a certain player into an index within the board.
+	virtual void make_index(Player player, int row, int col) = 0;
+
+	virtual Player get_node_value(int row, int col) const = 0;
+
+	virtual Player check_winner() const = 0;
+
+	// Plays the AI's move for BLUE and prints what the search found
+	virtual void next_move() = 0;
+
+	// Searches for player's move with the current settings and returns it without
+	// playing it or printing anything
+	virtual ai_move find_move(Player player) = 0;
+	virtual const search_info &last_search() const = 0;
+
+	// Iterations of the last minimax search, empty unless the build has
+	// HEX_SEARCH_STATS
+	virtual const SearchStats &last_stats() const = 0;
+
+	// Appends last_stats() of every later minimax search to the file at path,
+	// one line of JSON per move. An empty path stops the log.
+	virtual void set_stats_log(const std::string &path) = 0;
+
+	virtual void print_board() const = 0;
+
+	// Size of the transposition table used by next_move(), 0 turns it off
+	virtual void set_table_size(size_t megabytes) = 0;
+
+	// Wall clock budget next_move() searches to, 0 means until max_depth
+	virtual void set_move_time(int milliseconds) = 0;
+
+	// Depth limit for next_move(), 0 means no limit
+	virtual void set_max_depth(int depth) = 0;
+
+	// Threads next_move() searches with. One thread always picks the same move
+	// for the same position. Whether more threads search deeper in the same
+	// time hasn't been measured yet, see ParallelSearch.h.
+	virtual void set_threads(int count) = 0;
+
+	virtual void set_engine(Engine engine) = 0;
+
+	// Playout budget for the MCTS engine on top of the time budget, 0 means
+	// the time budget alone decides
+	virtual void set_playouts(uint64_t playouts) = 0;
+
+	virtual void set_evaluator(Evaluator evaluator) = 0;
+
+	// Weights PATTERNS scores with, read from a file written like the one
+	// "Hex patterns" writes. Throws when the file can't be read. An empty path
+	// goes back to the built in weights.
+	virtual void set_pattern_weights(const std::string &path) = 0;
+
+	// Leaves dead and captured cells out of the minimax move lists, see
+	// InferiorCells.h. On by default.
+	virtual void set_pruning(bool enabled) = 0;
+
+	// Book the AI looks its moves up in before it searches, see OpeningBook.
+	// Throws when the file isn't a book for this size. An empty path drops it.
+	virtual void set_opening_book(const std::string &path) = 0;
+
+	// With pondering on, start_game() has the AI search on a worker thread
+	// while it waits for the human's move. Only MINIMAX ponders, since it is
+	// the engine that keeps what it learns in its transposition table.
+	virtual void set_pondering(bool enabled) = 0;
+
+	// Guesses the move of player, who is about to move, and searches the position
+	// after it on a copy of the board until stop_pondering() or the next search.
+	// If the guess was right the next search takes the time spent pondering off
+	// its budget and picks up from the transposition table where pondering left
+	// off. Does nothing with pondering off.
+	virtual void start_pondering(Player player) = 0;
+	virtual void stop_pondering() = 0;
+
+	void start_game();
+
+	// Cells in the usual Hex notation, a column letter and a row number from 1,
+	// so (row 2, col 0) is "a3". parse_cell() checks the format but not the size.
+	static std::string cell_name(int row, int col);
+	static bool parse_cell(const std::string &name, int &row, int &col);
+
+protected:
+	enum game_state {PLAYER, COMPUTER, GAME_OVER};
+};
+
+// An NxN board, compiled for N when N is one of HEX_FIXED_SIZES and sized at
+// run time otherwise
+std::unique_ptr<HexGame> make_board(int n);
@@ -0,0 +1,113 @@
+#include <stdexcept>
+#include <string>
+#include "HexGeometry.h"
+using namespace std;
+
+// splitmix64, a small generator whose output is good enough for hash keys
+static uint64_t next_key(uint64_t &state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+template <int N>
+HexGeometry<N>::HexGeometry(int n) : n(n)
+{
+	if (n < 1 || n > MAX_SIZE)
+	{
+		throw invalid_argument("board size must be between 1 and " + to_string(MAX_SIZE));
+	}
+	if (N > 0 && n != N)
+	{
+		throw invalid_argument("this board is compiled for size " + to_string(N));
+	}
+
+	if (N == 0)
+	{
+		neighbor_lists.resize(n * n);
+		neighbor_rings.resize(n * n);
+		edge_flags.resize(n * n);
+	}
+	size_cells(neighbor_masks, n * n);
+	size_cells(row_masks, n);
+	size_cells(col_masks, n);
+	size_cells(zobrist_keys, 2 * n * n);
+
+	for (int row = 0; row < n; row++)
+	{
+		for (int col = 0; col < n; col++)
+		{
+			const int cell = row * n + col;
+			all_cells.set(cell);
+			row_masks[row].set(cell);
+			col_masks[col].set(cell);
+
+			// Fixed sizes already have these from the compiler
+			if (N == 0)
+			{
+				neighbor_lists[cell] = make_neighbor_list(n, row, col);
+				neighbor_rings[cell] = make_neighbor_ring(n, row, col);
+				edge_flags[cell] = make_edge_flags(n, row, col);
+			}
+			for (int neighbor : neighbors(cell))
+			{
+				neighbor_masks[cell].set(neighbor);
+			}
+		}
+	}
+
+	uint64_t seed = 0x48657842u; // "HexB"
+	for (uint64_t &key : zobrist_keys)
+	{
+		key = next_key(seed);
+	}
+	zobrist_side = next_key(seed);
+
+	north_edge = row_masks[0];
+	south_edge = row_masks[n - 1];
+	west_edge = col_masks[0];
+	east_edge = col_masks[n - 1];
+}
+
+// The six neighbor offsets are -n, -n + 1, -1, +1, n - 1 and n. Moves that change
+// the column must not wrap around the side of the board, so those are taken from
+// the cells that are not already on that side.
+template <int N>
+typename HexGeometry<N>::Bits HexGeometry<N>::dilate(const Bits &cells) const
+{
+	const int n = V();
+	Bits can_go_east = cells;
+	can_go_east.clear(east_edge);
+	Bits can_go_west = cells;
+	can_go_west.clear(west_edge);
+
+	Bits result = cells.shifted_up(n);
+	result |= cells.shifted_down(n);
+	result |= can_go_east.shifted_up(1);
+	result |= can_go_east.shifted_down(n - 1);
+	result |= can_go_west.shifted_down(1);
+	result |= can_go_west.shifted_up(n - 1);
+	return result &= all_cells;
+}
+
+template <int N>
+typename HexGeometry<N>::Bits HexGeometry<N>::flood_fill(Bits seed, const Bits &region) const
+{
+	seed &= region;
+	while (true)
+	{
+		Bits grown = dilate(seed) & region;
+		grown |= seed;
+		if (grown == seed)
+		{
+			return seed;
+		}
+		seed = grown;
+	}
+}
+
+#define INSTANTIATE(N) template class HexGeometry<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Bitboard.h"
+
+// Board sizes that get a HexBoard<N> of their own. HexBoard<0> takes its size
+// at run time and covers every other size. Templates over the board size are
+// defined in .cpp files and instantiated there for each of these.
+#define HEX_FIXED_SIZES(X) X(7) X(8) X(9) X(11) X(13) X(19)
+#define HEX_ALL_SIZES(X) X(0) HEX_FIXED_SIZES(X)
+
+// Up to six neighbors of a cell, stored as cell indices (row * n + col)
+struct NeighborList
+{
+	int count;
+	int cell[6];
+
+	inline const int *begin() const { return cell; }
+	inline const int *end() const { return cell + count; }
+};
+
+// The edges a cell lies on, one bit each
+enum EdgeFlag { NORTH_EDGE = 1, SOUTH_EDGE = 2, WEST_EDGE = 4, EAST_EDGE = 8 };
+
+// A cell touches every cell of the surrounding 3x3 block except for itself and
+// the two on its main diagonal. This is the walk the old legal_neighbors() did.
+constexpr NeighborList make_neighbor_list(int n, int row, int col)
+{
+	NeighborList list = {};
+	for (int i = row - 1; i < row + 2; i++)
+	{
+		for (int j = col - 1; j < col + 2; j++)
+		{
+			if ((i - row) != (j - col) && i >= 0 && i < n && j >= 0 && j < n)
+			{
+				list.cell[list.count++] = i * n + j;
+			}
+		}
+	}
+	return list;
+}
+
+// The six places around a cell in order around it, so that places next to
+// each other in the ring are next to each other on the board. Places off the
+// board hold the edge they are beyond, or RING_CORNER beyond two edges at once.
+enum RingEdge { RING_RED_EDGE = -1, RING_BLUE_EDGE = -2, RING_CORNER = -3 };
+
+struct NeighborRing
+{
+	int cell[6];
+};
+
+// Row and column steps of the ring
+constexpr int RING_ROW[6] = { -1, -1, 0, 1, 1, 0 };
+constexpr int RING_COL[6] = { 0, 1, 1, 0, -1, -1 };
+
+constexpr NeighborRing make_neighbor_ring(int n, int row, int col)
+{
+	NeighborRing ring = {};
+	for (int i = 0; i < 6; i++)
+	{
+		const int r = row + RING_ROW[i];
+		const int c = col + RING_COL[i];
+		const bool off_row = r < 0 || r >= n;
+		const bool off_col = c < 0 || c >= n;
+		ring.cell[i] = off_row && off_col ? RING_CORNER : off_row ? RING_RED_EDGE : off_col ? RING_BLUE_EDGE : r * n + c;
+	}
+	return ring;
+}
+
+constexpr int make_edge_flags(int n, int row, int col)
+{
+	return (row == 0 ? NORTH_EDGE : 0) | (row == n - 1 ? SOUTH_EDGE : 0)
+		| (col == 0 ? WEST_EDGE : 0) | (col == n - 1 ? EAST_EDGE : 0);
+}
+
+// Neighbor and edge tables of an NxN board, built by the compiler
+template <int N>
+struct CellTables
+{
+	NeighborList neighbors[N > 0 ? N * N : 1];
+	NeighborRing rings[N > 0 ? N * N : 1];
+	int edges[N > 0 ? N * N : 1];
+};
+
+template <int N>
+constexpr CellTables<N> make_cell_tables()
+{
+	CellTables<N> tables = {};
+	for (int row = 0; row < N; row++)
+	{
+		for (int col = 0; col < N; col++)
+		{
+			tables.neighbors[row * N + col] = make_neighbor_list(N, row, col);
+			tables.rings[row * N + col] = make_neighbor_ring(N, row, col);
+			tables.edges[row * N + col] = make_edge_flags(N, row, col);
+		}
+	}
+	return tables;
+}
+
+// Per cell storage: inline arrays when the size is known at compile time,
+// vectors sized by the constructor when it isn't
+template <class T, int Count>
+using CellArray = typename std::conditional<Count == 0, std::vector<T>, std::array<T, Count>>::type;
+
+template <class T>
+inline void size_cells(std::vector<T> &cells, int count) { cells.resize(count); }
+template <class T, std::size_t Count>
+inline void size_cells(std::array<T, Count> &, int) {}
+
+// Lookup tables for an NxN board. They only depend on the size of the board,
+// so they are computed once and shared by every copy of a HexBoard.
+// For N > 0 the size, the neighbor lists and the edges are compile time
+// constants and the bit sets are only as wide as the board needs. HexGeometry<0>
+// is the fallback that takes its size at run time.
+template <int N>
+class HexGeometry
+{
+public:
+	static const int MAX_SIZE = 19;
+
+	typedef typename BoardBits<N>::type Bits;
+
+	explicit HexGeometry(int n = N);
+
+	inline int V() const { return N > 0 ? N : n; };
+	inline int cell_count() const { return V() * V(); };
+
+	inline const NeighborList &neighbors(int cell) const { return N > 0 ? fixed.neighbors[cell] : neighbor_lists[cell]; }
+	inline const NeighborRing &ring(int cell) const { return N > 0 ? fixed.rings[cell] : neighbor_rings[cell]; }
+	inline int edges(int cell) const { return N > 0 ? fixed.edges[cell] : edge_flags[cell]; }
+	inline const Bits &neighbor_mask(int cell) const { return neighbor_masks[cell]; }
+
+	// Random key for a stone of player (0 or 1) on cell. The keys come from a fixed
+	// seed so a position hashes to the same value in every run, and the same
+	// position gets the same hash on a fixed size board and on the fallback.
+	inline uint64_t zobrist(int player, int cell) const { return zobrist_keys[2 * cell + player]; }
+
+	// Every cell that is adjacent to at least one cell of the given set
+	Bits dilate(const Bits &cells) const;
+
+	// Grows seed through the cells of region until it stops changing
+	Bits flood_fill(Bits seed, const Bits &region) const;
+
+	Bits all_cells;
+	Bits north_edge; // row 0, the start of RED
+	Bits south_edge; // row n - 1, the goal of RED
+	Bits west_edge;  // col 0, the start of BLUE
+	Bits east_edge;  // col n - 1, the goal of BLUE
+	CellArray<Bits, N> row_masks;
+	CellArray<Bits, N> col_masks;
+
+	// Mixed into a hash when BLUE is the player to move
+	uint64_t zobrist_side;
+
+private:
+	static constexpr CellTables<N> fixed = make_cell_tables<N>();
+
+	int n;
+	std::vector<NeighborList> neighbor_lists; // fallback only, fixed sizes use fixed
+	std::vector<NeighborRing> neighbor_rings;
+	std::vector<int> edge_flags;
+	CellArray<Bits, N * N> neighbor_masks;
+	CellArray<uint64_t, 2 * N * N> zobrist_keys;
+};
+
+template <int N>
+constexpr CellTables<N> HexGeometry<N>::fixed;
@@ -0,0 +1,137 @@
+#include "InferiorCells.h"
+using namespace std;
+
+// A ring is a number in base 3 with one digit per place around the cell:
+// 0 for blank or a corner, 1 for RED and 2 for BLUE
+static const int RING_CODES = 729;
+static const int DIGIT[6] = { 1, 3, 9, 27, 81, 243 };
+
+// Whether a stone of player (1 or 2) on a cell with this ring never joins
+// anything for player that isn't joined without it
+constexpr bool useless_to(int code, int player)
+{
+	int place[6] = {};
+	for (int i = 0; i < 6; i++, code /= 3)
+	{
+		place[i] = code % 3;
+	}
+	const int opponent = 3 - player;
+	for (int a = 0; a < 6; a++)
+	{
+		for (int b = a + 1; b < 6 && place[a] != opponent; b++)
+		{
+			if (place[b] == opponent)
+			{
+				continue;
+			}
+			bool one_way = true;
+			for (int k = a + 1; k < b; k++)
+			{
+				one_way = one_way && place[k] == player;
+			}
+			bool other_way = true;
+			for (int k = b + 1; k < a + 6; k++)
+			{
+				other_way = other_way && place[k % 6] == player;
+			}
+			if (!one_way && !other_way)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+struct DeadRings
+{
+	bool dead[RING_CODES];
+};
+
+constexpr DeadRings make_dead_rings()
+{
+	DeadRings rings = {};
+	for (int code = 0; code < RING_CODES; code++)
+	{
+		// Whoever wins is the player that connects, so a cell that can't help
+		// one of them can't matter to either
+		rings.dead[code] = useless_to(code, 1) || useless_to(code, 2);
+	}
+	return rings;
+}
+
+static constexpr DeadRings DEAD_RINGS = make_dead_rings();
+
+template <int N>
+static int ring_code(const HexBoard<N> &board, const NeighborRing &ring)
+{
+	const typename HexBoard<N>::Bits &red = board.stones(HexGame::RED);
+	const typename HexBoard<N>::Bits &blue = board.stones(HexGame::BLUE);
+	int code = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		const int cell = ring.cell[i];
+		int digit = 0;
+		if (cell >= 0)
+		{
+			digit = red.test(cell) ? 1 : blue.test(cell) ? 2 : 0;
+		}
+		else if (cell != RING_CORNER)
+		{
+			digit = cell == RING_RED_EDGE ? 1 : 2;
+		}
+		code += digit * DIGIT[i];
+	}
+	return code;
+}
+
+template <int N>
+typename HexBoard<N>::Bits inferior_cells(const HexBoard<N> &board)
+{
+	typedef typename HexBoard<N>::Bits Bits;
+	const HexGeometry<N> &g = board.tables();
+	const Bits blank = board.blank_cells();
+
+	int codes[HexGeometry<N>::MAX_SIZE * HexGeometry<N>::MAX_SIZE];
+	Bits inferior;
+	blank.for_each([&](int cell)
+	{
+		codes[cell] = ring_code(board, g.ring(cell));
+		if (DEAD_RINGS.dead[codes[cell]])
+		{
+			inferior.set(cell);
+		}
+	});
+
+	// The blank neighbor at place i of a cell sees the cell at place i + 3
+	blank.for_each([&](int cell)
+	{
+		if (inferior.test(cell))
+		{
+			return;
+		}
+		const NeighborRing &ring = g.ring(cell);
+		for (int i = 0; i < 6; i++)
+		{
+			const int other = ring.cell[i];
+			if (other < 0 || !blank.test(other) || inferior.test(other))
+			{
+				continue;
+			}
+			for (int player = 1; player <= 2; player++)
+			{
+				if (DEAD_RINGS.dead[codes[cell] + player * DIGIT[i]] && DEAD_RINGS.dead[codes[other] + player * DIGIT[(i + 3) % 6]])
+				{
+					inferior.set(cell);
+					inferior.set(other);
+					return;
+				}
+			}
+		}
+	});
+	return inferior;
+}
+
+#define INSTANTIATE(N) template HexBoard<N>::Bits inferior_cells<N>(const HexBoard<N> &board);
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
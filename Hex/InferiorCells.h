@@ -0,0 +1,22 @@
+#pragma once
+
+#include "HexBoard.h"
+
+// Blank cells no search has to try, found from the six places around each cell.
+//
+// A cell is dead when the color of a stone on it can't change who wins: every
+// two places around it that a player could join through it are already next
+// to each other, or joined by that player's stones further round the ring.
+// Which rings are like that is worked out once for all 3^6 of them, with the
+// edges counting as stones of the player they belong to.
+//
+// Two blank neighbors are captured by a player when that player's stone on
+// either one makes the other dead. The opponent gains nothing by playing one,
+// since the player answers on the other, and the player gains nothing by
+// filling them early. Captured pairs are taken greedily and never overlap, so
+// the player always has an answer to every one of them.
+//
+// Cells only get more dead as stones are added, so what this finds stays true
+// for the rest of the game.
+template <int N>
+typename HexBoard<N>::Bits inferior_cells(const HexBoard<N> &board);
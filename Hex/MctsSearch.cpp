@@ -0,0 +1,313 @@
+#include <cmath>
+#include <memory>
+#include <thread>
+#include "MctsSearch.h"
+using namespace std;
+
+// A leaf grows children once it has been visited this often. Expanding on the
+// first visit fills the pool with nodes that are never looked at again.
+static const uint32_t EXPAND_VISITS = 2;
+
+// Nodes a tree has room for before its vector grows
+static const size_t INITIAL_NODES = 1 << 14;
+
+// xorshift64*, fast enough that the playouts are not waiting on it
+static inline uint64_t next_random(uint64_t &state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, range) without a division
+static inline int random_below(uint64_t &state, int range)
+{
+	return (int)(((next_random(state) >> 32) * (uint64_t)range) >> 32);
+}
+
+template <int N>
+MctsSearch<N>::Worker::Worker(const HexBoard<N> &board, size_t node_limit, uint64_t seed) : board(board), node_limit(node_limit), random_state(seed | 1), playouts(0)
+{
+	pool.reserve(node_limit < INITIAL_NODES ? node_limit : INITIAL_NODES);
+	path.reserve(board.tables().cell_count() + 1);
+	cells.reserve(board.tables().cell_count());
+}
+
+template <int N>
+MctsSearch<N>::MctsSearch(const HexBoard<N> &board, int threads, uint64_t seed) : board(board), threads(threads > 1 ? threads : 1), seed(seed), node_limit(1 << 22), exploration(0.2), rave_bias(0.025), has_deadline(false), playout_limit(0), playouts_started(0), stopped(false), playout_count(0), node_count(0)
+{
+}
+
+template <int N>
+void MctsSearch<N>::set_node_limit(size_t nodes)
+{
+	node_limit = nodes;
+}
+
+template <int N>
+void MctsSearch<N>::set_exploration(double c)
+{
+	exploration = c;
+}
+
+template <int N>
+void MctsSearch<N>::set_rave_bias(double bias)
+{
+	rave_bias = bias;
+}
+
+template <int N>
+ai_move MctsSearch<N>::search(HexGame::Player player, int milliseconds, uint64_t max_playouts)
+{
+	ai_move best_move(0);
+	best_move.x = -1;
+	best_move.y = -1;
+	playout_count = 0;
+	node_count = 0;
+	if (board.blank_count() == 0)
+	{
+		return best_move;
+	}
+
+	has_deadline = milliseconds > 0;
+	deadline = chrono::steady_clock::now() + chrono::milliseconds(milliseconds);
+	playout_limit = milliseconds <= 0 && max_playouts == 0 ? 1 : max_playouts;
+	playouts_started = 0;
+	stopped = false;
+
+	// Every worker gets a different stream of random numbers, and the first one
+	// gets the same stream every time so a single thread is reproducible
+	vector<unique_ptr<Worker>> workers;
+	for (int i = 0; i < threads; i++)
+	{
+		workers.emplace_back(new Worker(board, node_limit / threads, seed + i * 0x9E3779B97F4A7C15ULL));
+	}
+
+	vector<thread> helpers;
+	for (int i = 1; i < threads; i++)
+	{
+		Worker *worker = workers[i].get();
+		helpers.emplace_back([this, worker, player]()
+		{
+			run(*worker, player);
+		});
+	}
+	run(*workers[0], player);
+	for (thread &helper : helpers)
+	{
+		helper.join();
+	}
+
+	// Add up the root children of every tree by cell
+	const int cells = board.tables().cell_count();
+	vector<uint64_t> visits(cells), wins(cells);
+	for (const unique_ptr<Worker> &worker : workers)
+	{
+		const Node &root = worker->pool[0];
+		for (int c = root.first_child; c < root.first_child + root.child_count; c++)
+		{
+			visits[worker->pool[c].move] += worker->pool[c].visits;
+			wins[worker->pool[c].move] += worker->pool[c].wins;
+		}
+		playout_count += worker->playouts;
+		node_count += worker->pool.size();
+	}
+
+	int best = -1;
+	for (int cell = 0; cell < cells; cell++)
+	{
+		if (visits[cell] > 0 && (best < 0 || visits[cell] > visits[best]))
+		{
+			best = cell;
+		}
+	}
+	if (best >= 0)
+	{
+		best_move.x = best / board.V();
+		best_move.y = best % board.V();
+		best_move.score = (int)(100 * wins[best] / visits[best]);
+	}
+	return best_move;
+}
+
+template <int N>
+void MctsSearch<N>::run(Worker &worker, HexGame::Player player) const
+{
+	Node root = {};
+	root.move = -1;
+	worker.pool.push_back(root);
+	expand(worker, 0);
+
+	while (true)
+	{
+		if (playout_limit > 0 && playouts_started.fetch_add(1, memory_order_relaxed) >= playout_limit)
+		{
+			break;
+		}
+		// Reading the clock costs about as much as a playout, so only look now and then
+		if (has_deadline && (worker.playouts & 63) == 0 && chrono::steady_clock::now() >= deadline)
+		{
+			stopped.store(true, memory_order_relaxed);
+		}
+		if (stopped.load(memory_order_relaxed))
+		{
+			break;
+		}
+
+		playout(worker, player);
+		worker.playouts++;
+	}
+}
+
+// One iteration: walk down the tree, deal out the rest of the board at random,
+// and carry the result back up the path
+template <int N>
+void MctsSearch<N>::playout(Worker &worker, HexGame::Player player) const
+{
+	HexBoard<N> &board = worker.board;
+	vector<Node> &pool = worker.pool;
+	const HexGame::Player opponent = player == HexGame::BLUE ? HexGame::RED : HexGame::BLUE;
+
+	// Selection. Once a move in the tree wins the game there is nothing below it
+	// worth growing, the random fill can't change the winner.
+	worker.path.clear();
+	worker.path.push_back(0);
+	int node = 0;
+	HexGame::Player to_move = player;
+	while (board.check_winner() == HexGame::BLANK)
+	{
+		if (pool[node].child_count == 0)
+		{
+			if (pool[node].visits < EXPAND_VISITS || board.blank_count() == 0)
+			{
+				break;
+			}
+			expand(worker, node);
+			if (pool[node].child_count == 0)
+			{
+				break;
+			}
+		}
+
+		node = select(worker, node);
+		board.make_index(to_move, pool[node].move);
+		worker.path.push_back(node);
+		to_move = to_move == HexGame::BLUE ? HexGame::RED : HexGame::BLUE;
+	}
+
+	// Simulation. Players alternate, so the player to move ends up with the first
+	// half of a random order of the blanks (rounded up) and the other player gets
+	// the rest. Only that first half needs shuffling.
+	Bits final_stones[2] = { board.stones(HexGame::RED), board.stones(HexGame::BLUE) };
+	const int blank_total = board.blank_count();
+	worker.cells.assign(board.blank_list(), board.blank_list() + blank_total);
+	int *cells = worker.cells.data();
+	const int take = (blank_total + 1) / 2;
+	for (int i = 0; i < take; i++)
+	{
+		const int j = i + random_below(worker.random_state, blank_total - i);
+		const int cell = cells[j];
+		cells[j] = cells[i];
+		cells[i] = cell;
+		final_stones[to_move].set(cell);
+	}
+	const HexGame::Player waiting = to_move == HexGame::BLUE ? HexGame::RED : HexGame::BLUE;
+	for (int i = take; i < blank_total; i++)
+	{
+		final_stones[waiting].set(cells[i]);
+	}
+
+	// A full board always has exactly one winner, so BLUE either joins west to
+	// east or RED has joined north to south
+	const HexGeometry<N> &geometry = board.tables();
+	const Bits &blue = final_stones[HexGame::BLUE];
+	const Bits blue_reach = geometry.flood_fill(blue & geometry.west_edge, blue);
+	const HexGame::Player winner = blue_reach.intersects(geometry.east_edge) ? HexGame::BLUE : HexGame::RED;
+
+	// Backpropagation. path[i] was played by the player to move at path[i - 1],
+	// and every child of path[i] gets an all-moves-as-first update if the player
+	// to move there owns its cell on the final board.
+	const int length = (int)worker.path.size();
+	for (int i = 0; i < length; i++)
+	{
+		Node &current = pool[worker.path[i]];
+		const HexGame::Player mover = i % 2 == 0 ? opponent : player;
+		const HexGame::Player chooser = i % 2 == 0 ? player : opponent;
+
+		current.visits++;
+		current.wins += winner == mover;
+
+		const Bits &owned = final_stones[chooser];
+		const uint32_t won = winner == chooser;
+		for (int c = current.first_child; c < current.first_child + current.child_count; c++)
+		{
+			if (owned.test(pool[c].move))
+			{
+				pool[c].rave_visits++;
+				pool[c].rave_wins += won;
+			}
+		}
+	}
+
+	for (int i = 1; i < length; i++)
+	{
+		board.unmake_index();
+	}
+}
+
+// Gives node a child for every blank cell, unless the pool has no room for them
+template <int N>
+void MctsSearch<N>::expand(Worker &worker, int node) const
+{
+	const int blank_total = worker.board.blank_count();
+	if (blank_total == 0 || worker.pool.size() + blank_total > worker.node_limit)
+	{
+		return;
+	}
+
+	worker.pool[node].first_child = (int32_t)worker.pool.size();
+	worker.pool[node].child_count = (int16_t)blank_total;
+	const int *blanks = worker.board.blank_list();
+	for (int i = 0; i < blank_total; i++)
+	{
+		Node child = {};
+		child.move = (int16_t)blanks[i];
+		worker.pool.push_back(child);
+	}
+}
+
+// UCT with RAVE: the value of a child mixes its real win rate with its
+// all-moves-as-first win rate, trusting RAVE less as real visits come in.
+// A child with no data of either kind counts as an even game.
+template <int N>
+int MctsSearch<N>::select(const Worker &worker, int node) const
+{
+	const Node &parent = worker.pool[node];
+	const double log_visits = log((double)parent.visits + 1);
+	const double bias = 4 * rave_bias * rave_bias;
+
+	int best = parent.first_child;
+	double best_value = -1;
+	for (int c = parent.first_child; c < parent.first_child + parent.child_count; c++)
+	{
+		const Node &child = worker.pool[c];
+		const double n = child.visits;
+		const double rave_n = child.rave_visits;
+		const double q = n > 0 ? child.wins / n : 0.5;
+		const double rave_q = rave_n > 0 ? child.rave_wins / rave_n : 0.5;
+		const double beta = n > 0 ? rave_n / (n + rave_n + bias * n * rave_n) : 1.0;
+
+		const double value = (1 - beta) * q + beta * rave_q + exploration * sqrt(log_visits / (n + 1));
+		if (value > best_value)
+		{
+			best_value = value;
+			best = c;
+		}
+	}
+	return best;
+}
+
+#define INSTANTIATE(N) template class MctsSearch<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
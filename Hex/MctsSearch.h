@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "HexBoard.h"
+
+// Monte Carlo tree search with UCT and RAVE, as an alternative to MinimaxSearch.
+//
+// A Hex playout always ends on a full board with exactly one winner, so a
+// playout just deals the remaining blank cells out at random and checks the
+// finished board once with a flood fill. The full board also records which
+// cells each player ended up with, which is everything RAVE needs.
+//
+// Each thread grows its own tree from its own copy of the board (root
+// parallel), and the root statistics of all trees are added up at the end.
+// A tree is one vector of nodes, and a node's children sit next to each other
+// in it. It starts small and grows up to the node limit, so a short search
+// doesn't claim the memory of a long one.
+template <int N>
+class MctsSearch
+{
+public:
+	explicit MctsSearch(const HexBoard<N> &board, int threads = 1, uint64_t seed = 0x4D435453);
+
+	// Upper bound on the nodes of all trees together. Once a tree is full its
+	// leaves stop expanding and further playouts only refine what is there.
+	void set_node_limit(size_t nodes);
+
+	// UCT exploration constant. RAVE does most of the exploring, so it is small.
+	void set_exploration(double c);
+
+	// How quickly RAVE values give way to real ones as a node gets visited,
+	// smaller values trust RAVE for longer
+	void set_rave_bias(double bias);
+
+	// Runs playouts for player until the time budget or the playout budget is
+	// used up, whichever comes first. A budget of 0 means no limit, and with
+	// neither budget set it runs a single playout, so there is always a move.
+	// Returns the most visited move, with the estimated chance of winning
+	// after it in percent as the score.
+	ai_move search(HexGame::Player player, int milliseconds, uint64_t max_playouts = 0);
+
+	// Playouts run by all threads in the last search
+	inline uint64_t playouts() const { return playout_count; };
+
+	// Nodes in all trees after the last search
+	inline size_t tree_size() const { return node_count; };
+
+private:
+	typedef typename HexBoard<N>::Bits Bits;
+
+	struct Node
+	{
+		int16_t move;        // cell played to reach this node
+		int16_t child_count; // 0 until the node is expanded
+		int32_t first_child; // index of the first child in the pool
+		uint32_t visits;
+		uint32_t wins;       // for the player who played move
+		uint32_t rave_visits;
+		uint32_t rave_wins;
+	};
+
+	struct Worker
+	{
+		Worker(const HexBoard<N> &board, size_t node_limit, uint64_t seed);
+
+		HexBoard<N> board;
+		std::vector<Node> pool;
+		size_t node_limit;
+		std::vector<int> path;
+		std::vector<int> cells;
+		uint64_t random_state;
+		uint64_t playouts;
+	};
+
+	void run(Worker &worker, HexGame::Player player) const;
+	void playout(Worker &worker, HexGame::Player player) const;
+	void expand(Worker &worker, int node) const;
+	int select(const Worker &worker, int node) const;
+
+	const HexBoard<N> &board;
+	int threads;
+	uint64_t seed;
+	size_t node_limit;
+	double exploration;
+	double rave_bias;
+
+	// Budget shared by the threads of the running search
+	std::chrono::steady_clock::time_point deadline;
+	bool has_deadline;
+	uint64_t playout_limit;
+	mutable std::atomic<uint64_t> playouts_started;
+	mutable std::atomic<bool> stopped;
+
+	uint64_t playout_count;
+	size_t node_count;
+};
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "OpeningBook.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+static const char MAGIC[8] = { 'H', 'E', 'X', 'B', 'O', 'O', 'K', '1' };
+static const size_t HEADER_SIZE = 16;
+
+static_assert(sizeof(OpeningBook::Entry) == 16, "entries are written to the file as they are in memory");
+
+// Maps the whole file read only. The mapping stays valid after the file is
+// closed, so no handle has to be kept around.
+static const unsigned char *map_file(const string &path, size_t &length)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER file_size;
+	const void *view = nullptr;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+	{
+		length = (size_t)file_size.QuadPart;
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	return (const unsigned char *)view;
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return nullptr;
+	}
+	struct stat status;
+	void *view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		length = (size_t)status.st_size;
+		view = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+	}
+	close(file);
+	return view == MAP_FAILED ? nullptr : (const unsigned char *)view;
+#endif
+}
+
+static void unmap_file(const unsigned char *data, size_t length)
+{
+#ifdef _WIN32
+	(void)length;
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, length);
+#endif
+}
+
+OpeningBook::OpeningBook(const string &path) : data(nullptr), length(0), entries(nullptr), count(0), size(0)
+{
+	data = map_file(path, length);
+	if (!data)
+	{
+		throw runtime_error("can't map " + path);
+	}
+
+	uint32_t header[2];
+	if (length >= HEADER_SIZE)
+	{
+		memcpy(header, data + sizeof(MAGIC), sizeof(header));
+	}
+	if (length < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+		|| header[0] < 1 || header[0] > 19 || length != HEADER_SIZE + (size_t)header[1] * sizeof(Entry))
+	{
+		unmap_file(data, length);
+		throw runtime_error(path + " is not an opening book");
+	}
+	size = (int)header[0];
+	count = header[1];
+
+	// The header keeps the entries 8 byte aligned in the page aligned mapping
+	entries = (const Entry *)(data + HEADER_SIZE);
+}
+
+OpeningBook::~OpeningBook()
+{
+	unmap_file(data, length);
+}
+
+const OpeningBook::Entry *OpeningBook::find(uint64_t key) const
+{
+	const Entry *end = entries + count;
+	const Entry *entry = lower_bound(entries, end, key, [](const Entry &e, uint64_t k) { return e.key < k; });
+	return entry != end && entry->key == key ? entry : nullptr;
+}
+
+void OpeningBook::write(const string &path, int size, vector<Entry> entries)
+{
+	sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.key < b.key; });
+
+	ofstream out(path, ios::binary | ios::trunc);
+	const uint32_t header[2] = { (uint32_t)size, (uint32_t)entries.size() };
+	out.write(MAGIC, sizeof(MAGIC));
+	out.write((const char *)header, sizeof(header));
+	out.write((const char *)entries.data(), entries.size() * sizeof(Entry));
+	if (!out)
+	{
+		throw runtime_error("can't write " + path);
+	}
+}
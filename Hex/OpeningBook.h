@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A read only opening book for one board size, mapped into memory. The file is
+// a 16 byte header (the magic "HEXBOOK1", the board size and the number of
+// entries) followed by 16 byte entries sorted by key. Lookups binary search
+// the mapping in place, so opening a book reads nothing up front and a lookup
+// copies nothing. That also means the numbers are in the byte order of the
+// machine that built the book, and a book only works on machines with the
+// same byte order.
+//
+// Keys are HexBoard::canonical_hash() of a position with the side to move, and
+// moves are stored for the orientation the key was taken from. A board only
+// looks like its own 180 degree rotation to the players, so the book holds one
+// of the two and the caller turns the move around when the key was rotated.
+class OpeningBook
+{
+public:
+	struct Entry
+	{
+		uint64_t key;
+		int16_t move;  // cell index in the canonical orientation
+		int16_t depth; // how deep the builder searched
+		int32_t score; // from BLUE's point of view, like minimax
+	};
+
+	// Maps the file, throws runtime_error when it can't or when it isn't a book
+	explicit OpeningBook(const std::string &path);
+	~OpeningBook();
+
+	OpeningBook(const OpeningBook &) = delete;
+	OpeningBook &operator=(const OpeningBook &) = delete;
+
+	inline int board_size() const { return size; };
+	inline size_t entry_count() const { return count; };
+
+	// The entry for key, or null when the book has no move for it
+	const Entry *find(uint64_t key) const;
+
+	// Sorts entries by key and writes them as a book for the given board size
+	static void write(const std::string &path, int size, std::vector<Entry> entries);
+
+private:
+	const unsigned char *data;
+	size_t length;
+	const Entry *entries;
+	size_t count;
+	int size;
+};
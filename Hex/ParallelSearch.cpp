@@ -0,0 +1,73 @@
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ParallelSearch.h"
+#include "Search.h"
+using namespace std;
+
+template <int N>
+ParallelSearch<N>::ParallelSearch(HexBoard<N> &board, TranspositionTable *table, int threads) : board(board), table(table), threads(threads > 1 ? threads : 1), stats(nullptr), stop_flag(nullptr), node_count(0), last_depth(0)
+{
+}
+
+template <int N>
+ai_move ParallelSearch<N>::iterative_deepening(HexGame::Player player, pair<int, int> cord, int milliseconds, int max_depth)
+{
+	MinimaxSearch<N> main_search(board, table);
+	main_search.set_stats(stats);
+	main_search.set_stop_flag(stop_flag);
+	if (threads == 1)
+	{
+		const ai_move best_move = main_search.iterative_deepening(player, cord, milliseconds, max_depth);
+		node_count = main_search.nodes();
+		last_depth = main_search.completed_depth();
+		return best_move;
+	}
+
+	// Helpers get their own boards, which share the geometry tables with this one
+	const int helper_total = threads - 1;
+	vector<HexBoard<N>> boards(helper_total, board);
+	vector<unique_ptr<MinimaxSearch<N>>> helpers;
+	helpers.reserve(helper_total);
+	atomic<bool> stop(false);
+	for (int i = 0; i < helper_total; i++)
+	{
+		helpers.emplace_back(new MinimaxSearch<N>(boards[i], table));
+		helpers.back()->set_stop_flag(&stop);
+	}
+
+	// Helpers have no deadline of their own, they run until the main thread is
+	// done. They ignore max_depth as well, since a deeper helper still fills
+	// the table with results the main thread can use.
+	vector<thread> workers;
+	workers.reserve(helper_total);
+	for (int i = 0; i < helper_total; i++)
+	{
+		MinimaxSearch<N> *helper = helpers[i].get();
+		const int first_depth = 1 + (i % 2 == 0);
+		workers.emplace_back([helper, player, cord, first_depth]()
+		{
+			helper->iterative_deepening(player, cord, 0, 0, first_depth);
+		});
+	}
+
+	const ai_move best_move = main_search.iterative_deepening(player, cord, milliseconds, max_depth);
+
+	stop.store(true, memory_order_relaxed);
+	for (thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	node_count = main_search.nodes();
+	for (const unique_ptr<MinimaxSearch<N>> &helper : helpers)
+	{
+		node_count += helper->nodes();
+	}
+	last_depth = main_search.completed_depth();
+	return best_move;
+}
+
+#define INSTANTIATE(N) template class ParallelSearch<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include "HexBoard.h"
+#include "SearchStats.h"
+#include "TranspositionTable.h"
+
+// Lazy SMP on top of MinimaxSearch. Every thread runs its own iterative
+// deepening search on its own copy of the board, and they only talk to each
+// other through the shared transposition table: whatever one thread finds,
+// the others pick up as hash moves and cutoffs. Half the helpers start one
+// depth ahead so the threads spread out over the tree instead of walking it
+// in lockstep. The main thread's result is the one that gets played.
+//
+// With one thread no helpers are started and the result is exactly that of
+// MinimaxSearch::iterative_deepening(), so single threaded play stays
+// reproducible. With more threads the move can depend on timing.
+//
+// How much the helpers shorten the time to a depth is not known yet. So far
+// the search has only been timed on a single core, where the helpers share
+// it with the main thread and can only slow it down: time to depth 5 on
+// 8x8-middle went to 0.92, 0.73 and 0.60 of one thread's speed at 2, 4 and
+// 8 threads. "hex_bench depth=5 threads=1,2,4,8" measures it on the corpus,
+// and until that has been run on a machine with at least 8 cores the
+// default stays at one thread.
+template <int N>
+class ParallelSearch
+{
+public:
+	// table may be null, though helpers get little out of running without one
+	ParallelSearch(HexBoard<N> &board, TranspositionTable *table, int threads = 1);
+
+	// Same contract as MinimaxSearch::iterative_deepening()
+	ai_move iterative_deepening(HexGame::Player player, std::pair<int, int> cord, int milliseconds, int max_depth = 0);
+
+	// Another thread can end the search early by setting this flag, see
+	// MinimaxSearch::set_stop_flag()
+	inline void set_stop_flag(const std::atomic<bool> *flag) { stop_flag = flag; };
+
+	// Statistics of the main thread's search, see MinimaxSearch::set_stats()
+	inline void set_stats(SearchStats *stats) { this->stats = stats; };
+
+	// Nodes visited by all threads together
+	inline uint64_t nodes() const { return node_count; };
+
+	// Deepest iteration the main thread finished
+	inline int completed_depth() const { return last_depth; };
+
+private:
+	HexBoard<N> &board;
+	TranspositionTable *table;
+	int threads;
+	SearchStats *stats;
+	const std::atomic<bool> *stop_flag;
+
+	uint64_t node_count;
+	int last_depth;
+};
@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "Arena.h"
+#include "HexBoard.h"
+#include "PatternEvaluator.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HEX_PATTERNS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEX_PATTERNS_SSE2
+#endif
+using namespace std;
+
+static const int RING_CODES = PatternWeights::RING_CODES;
+static const int DIGIT[6] = { 1, 3, 9, 27, 81, 243 };
+static const char SYMBOL[3] = { '.', 'x', 'o' };
+
+// PatternEvaluator scores only the patterns around the stones that changed
+// when there are at most this many of them, and the whole board otherwise
+static const int UPDATE_CELLS = 6;
+
+// PatternWeights::fit() passes over the positions this many times, and keeps
+// weights as whole numbers, a hundred to a unit of log odds
+static const int FIT_EPOCHS = 30;
+static const double FIT_RATE = 0.05;
+static const double FIT_DECAY = 1e-5;
+static const double FIT_SCALE = 100.0;
+
+// The built in weights, written out by "Hex patterns games=..." from 10500 games
+// of two-distance minimax against itself at depths 1 and 2, with 4 to 12 random
+// opening stones, on 8x8 and 11x11. Each row is for one color of the last three
+// places, south, south west and west.
+static const int16_t BUILTIN[PatternWeights::PATTERN_COUNT] = {
+	// blank cells
+	0, 2, -1, 1, 5, 0, -1, 1, -1, 1, 6, 0, 1, 1, 12, 0, -4, -12, -2, 0, -6, -1, -2, 4, -5, 2, -1,
+	2, -7, 0, 7, 9, 4, -3, -1, -3, -2, 6, -2, -4, -5, -3, -8, -7, -7, 0, -9, -8, -5, -12, -14, -8, 0, 0,
+	-1, 0, 0, -1, 8, -8, -1, -2, -2, 0, 3, 0, 0, 6, -3, -4, -3, -10, 2, 3, 4, -1, 3, 2, 0, -10, -1,
+	1, 7, -1, 0, -1, -1, 0, -3, -3, 1, -8, -1, -2, -19, 7, 1, -1, 10, 3, 10, -19, 1, 23, 6, -6, 11, -12,
+	5, 9, 8, -1, -8, 18, 6, 21, 0, 0, -13, 5, -10, -3, 0, 4, 23, 9, 8, 30, -9, 9, 27, 1, 0, 16, 2,
+	0, 4, -8, -1, 18, -29, -1, -9, -17, 4, 3, 3, -5, 14, 3, 0, -14, 17, 8, 14, -20, -5, 22, -21, -4, 6, -13,
+	-1, -3, -1, 0, 6, -1, 0, -1, 2, 1, 19, 1, 3, 12, -10, 1, -6, -7, -7, -10, 8, 3, -11, 1, 1, -23, 19,
+	1, -1, -2, -3, 21, -9, -1, -15, -13, 1, 16, -4, 0, 7, 5, 5, -6, -20, 5, 6, 5, 0, 9, -2, -9, -27, -18,
+	-1, -3, -2, -3, 0, -17, 2, -13, -20, 0, 14, -14, 0, 5, -13, 5, -3, -24, 4, -5, 16, 0, 3, -7, 10, -7, 1,
+	1, -2, 0, 1, 0, 4, 1, 1, 0, 0, -4, 0, 2, 1, 10, 8, -2, 3, 0, -3, -3, 2, 10, 3, -8, -3, -6,
+	6, 6, 3, -8, -13, 3, 19, 16, 14, -4, -24, 6, -16, -13, 12, 20, 22, 0, 8, 18, 0, -5, 19, -21, 9, 26, 9,
+	0, -2, 0, -1, 5, 3, 1, -4, -14, 0, 6, 0, 14, 4, -2, -3, -9, 2, 2, 0, -6, 4, 5, 9, -5, -5, -4,
+	1, -4, 0, -2, -10, -5, 3, 0, 0, 2, -16, 14, 20, -1, 24, 17, 7, 13, 3, 5, -14, 13, 7, 3, 0, -3, -5,
+	1, -5, 6, -19, -3, 14, 12, 7, 5, 1, -13, 4, -1, 26, -5, 13, 4, -17, 0, 1, -9, 18, 9, 19, -2, -3, 0,
+	12, -3, -3, 7, 0, 3, -10, 5, -13, 10, 12, -2, 24, -5, -38, -17, -11, 0, 7, 8, 0, 20, 19, -2, -9, 10, 17,
+	0, -8, -4, 1, 4, 0, 1, 5, 5, 8, 20, -3, 17, 13, -17, 29, 21, -3, -4, -14, -3, 9, -6, 14, -18, -22, -14,
+	-4, -7, -3, -1, 23, -14, -6, -6, -3, -2, 22, -9, 7, 4, -11, 21, 59, 2, 14, -9, 21, 2, 17, 0, -1, -10, -19,
+	-12, -7, -10, 10, 9, 17, -7, -20, -24, 3, 0, 2, 13, -17, 0, -3, 2, 38, 3, -8, -12, -5, -10, 11, 0, -19, 5,
+	-2, 0, 2, 3, 8, 8, -7, 5, 4, 0, 8, 2, 3, 0, 7, -4, 14, 3, 7, 9, -6, 1, 0, 7, -9, 12, 5,
+	0, -9, 3, 10, 30, 14, -10, 6, -5, -3, 18, 0, 5, 1, 8, -14, -9, -8, 9, 0, -18, -6, -1, 9, -30, 1, -1,
+	-6, -8, 4, -19, -9, -20, 8, 5, 16, -3, 0, -6, -14, -9, 0, -3, 21, -12, -6, -18, 24, -16, -26, -22, 13, -19, 13,
+	-1, -5, -1, 1, 9, -5, 3, 0, 0, 2, -5, 4, 13, 18, 20, 9, 2, -5, 1, -6, -16, 15, 27, 6, -21, -9, -7,
+	-2, -12, 3, 23, 27, 22, -11, 9, 3, 10, 19, 5, 7, 9, 19, -6, 17, -10, 0, -1, -26, 27, 73, 10, -16, 0, 3,
+	4, -14, 2, 6, 1, -21, 1, -2, -7, 3, -21, 9, 3, 19, -2, 14, 0, 11, 7, 9, -22, 6, 10, -59, -23, -17, -4,
+	-5, -8, 0, -6, 0, -4, 1, -9, 10, -8, 9, -5, 0, -2, -9, -18, -1, 0, -9, -30, 13, -21, -16, -23, 8, -27, 3,
+	2, 0, -10, 11, 16, 6, -23, -27, -7, -3, 26, -5, -3, -3, 10, -22, -10, -19, 12, 1, -19, -9, 0, -17, -27, -73, -9,
+	-1, 0, -1, -12, 2, -13, 19, -18, 1, -6, 9, -4, -5, 0, 17, -14, -19, 5, 5, -1, 13, -7, 3, -4, 3, -9, -26,
+	// own stones
+	3, 1, -5, 1, -6, 11, 3, 12, -6, -3, 20, -8, -1, -6, 20, -4, 14, -4, 2, 3, -11, 20, -2, 21, -2, 17, -20,
+	1, -8, -10, 9, -4, 17, 2, 12, -13, -18, 34, -16, 9, -7, 20, -7, -5, 7, 16, -6, -24, 29, 2, 29, -15, 13, -54,
+	-5, -10, 5, 1, -1, -8, 2, -10, 0, 3, 14, -5, 17, 3, 19, 7, 3, 0, 2, -12, 22, -1, -11, -2, -2, -4, 3,
+	1, 9, 1, -2, 6, 21, 5, 29, -4, 6, 18, -6, 26, -11, 23, 27, 6, 14, -1, 11, -9, -4, -14, 14, -14, 9, -16,
+	-6, -4, -1, 6, -20, 9, -1, 8, 0, -6, 10, -13, -45, -9, 12, 12, -16, 14, -2, -6, -12, 10, -18, 9, -13, -18, -52,
+	11, 17, -8, 21, 9, 4, 11, 21, -20, 10, 23, 9, 12, 8, 41, 19, 17, 18, 13, 4, -14, 8, -5, 18, 4, 21, -30,
+	3, 2, 2, 5, -1, 11, 11, -1, -7, -7, 12, -9, -1, -2, 16, -6, -7, -25, -6, 14, 1, -2, -16, -16, 2, 15, -3,
+	12, 12, -10, 29, 8, 21, -1, 9, -22, 14, 39, 22, 17, -16, 50, 12, 21, 4, 15, 8, -19, 26, 11, 23, -17, 19, -61,
+	-6, -13, 0, -4, 0, -20, -7, -22, 28, -14, -15, -26, -10, -1, 10, -28, -21, -14, 0, -8, 10, -7, -7, -14, 3, -13, 19,
+	-3, -18, 3, 6, -6, 10, -7, 14, -14, -7, 10, 7, -3, -4, 28, 14, 15, 3, -17, -8, -1, 7, -24, 21, -14, 10, -33,
+	20, 34, 14, 18, 10, 23, 12, 39, -15, 10, 43, 43, 32, 10, 78, -7, 22, 1, 10, 4, 7, 27, 7, 44, -18, 29, -37,
+	-8, -16, -5, -6, -13, 9, -9, 22, -26, 7, 43, 1, 25, 14, 27, 3, 12, -2, -9, -29, -12, 4, -12, 15, -40, -13, -51,
+	-1, 9, 17, 26, -45, 12, -1, 17, -10, -3, 32, 25, 35, -14, 39, 3, 0, 2, -4, 5, 12, 6, -9, 29, 12, 14, -43,
+	-6, -7, 3, -11, -9, 8, -2, -16, -1, -4, 10, 14, -14, 33, 34, -1, 3, 3, 5, -42, -6, 21, 1, 18, -40, -12, -75,
+	20, 20, 19, 23, 12, 41, 16, 50, 10, 28, 78, 27, 39, 34, 47, 17, 32, 19, 2, -21, 17, 9, -18, 32, 16, 39, -24,
+	-4, -7, 7, 27, 12, 19, -6, 12, -28, 14, -7, 3, 3, -1, 17, 13, 11, -11, -21, 18, -20, 5, -12, 21, -21, 20, -45,
+	14, -5, 3, 6, -16, 17, -7, 21, -21, 15, 22, 12, 0, 3, 32, 11, 44, -5, 3, 11, -5, 25, -10, 20, -16, 21, -47,
+	-4, 7, 0, 14, 14, 18, -25, 4, -14, 3, 1, -2, 2, 3, 19, -11, -5, 18, -3, 13, -1, -3, -14, 10, -16, 23, -19,
+	2, 16, 2, -1, -2, 13, -6, 15, 0, -17, 10, -9, -4, 5, 2, -21, 3, -3, 2, 16, -2, 4, -11, 16, -8, 21, -29,
+	3, -6, -12, 11, -6, 4, 14, 8, -8, -8, 4, -29, 5, -42, -21, 18, 11, 13, 16, 15, -16, 29, -2, 9, -26, 13, -51,
+	-11, -24, 22, -9, -12, -14, 1, -19, 10, -1, 7, -12, 12, -6, 17, -20, -5, -1, -2, -16, 55, -8, -27, -5, 12, -10, 10,
+	20, 29, -1, -4, 10, 8, -2, 26, -7, 7, 27, 4, 6, 21, 9, 5, 25, -3, 4, 29, -8, 17, -4, 14, -12, 22, -35,
+	-2, 2, -11, -14, -18, -5, -16, 11, -7, -24, 7, -12, -9, 1, -18, -12, -10, -14, -11, -2, -27, -4, -13, -10, -31, -10, -69,
+	21, 29, -2, 14, 9, 18, -16, 23, -14, 21, 44, 15, 29, 18, 32, 21, 20, 10, 16, 9, -5, 14, -10, 11, -16, 29, -32,
+	-2, -15, -2, -14, -13, 4, 2, -17, 3, -14, -18, -40, 12, -40, 16, -21, -16, -16, -8, -26, 12, -12, -31, -16, 21, -31, 14,
+	17, 13, -4, 9, -18, 21, 15, 19, -13, 10, 29, -13, 14, -12, 39, 20, 21, 23, 21, 13, -10, 22, -10, 29, -31, 19, -51,
+	-20, -54, 3, -16, -52, -30, -3, -61, 19, -33, -37, -51, -43, -75, -24, -45, -47, -19, -29, -51, 10, -35, -69, -32, 14, -51, 9,
+	// opponent stones
+	-3, -2, 3, -3, 2, 4, -1, -20, 1, 5, 11, 8, 6, 20, 4, -11, -21, -20, -1, -3, -20, -12, -17, -14, 6, 2, 6,
+	-2, -2, 17, 6, 8, 21, 1, -4, 4, -2, 2, 9, 0, 29, 3, -13, -16, -2, -16, -16, -10, -15, -21, -3, 2, 11, -5,
+	3, 17, 7, 7, 14, -14, -6, -7, 3, -3, 1, -7, 14, 33, -3, -10, -21, -28, 18, 8, -10, -14, -10, -15, 6, 24, 4,
+	-3, 6, 7, -11, -2, 6, -5, 2, 1, -2, -1, 9, 7, 3, 25, -11, 16, -16, -2, -14, -12, 1, -15, 7, 1, 16, 2,
+	2, 8, 14, -2, -21, 21, 14, 12, -12, 2, -12, 40, -3, -14, 16, -4, 16, -16, 15, 26, 18, 17, 31, 16, 13, 31, 40,
+	4, 21, -14, 6, 21, -13, -27, -5, -3, -7, 20, -3, 28, 45, 11, -19, -21, -17, 7, -18, 7, -12, -20, -11, -12, 12, 1,
+	-1, 1, -6, -5, 14, -27, 2, 4, -26, -1, 9, 6, 4, 16, -14, -21, -14, -23, -9, -11, -18, -29, -9, -6, -6, 14, 11,
+	-20, -4, -7, 2, 12, -5, 4, -17, -6, 1, 8, -4, 7, 35, 3, -8, -14, -9, -29, -29, -27, -26, -22, -25, -10, 4, -21,
+	1, 4, 3, 1, -12, -3, -26, -6, -35, -17, -12, -25, 10, 43, -2, -12, -29, -39, -9, -5, -32, -17, -14, 0, 45, 9, 14,
+	5, -2, -3, -2, 2, -7, -1, 1, -17, -5, -22, 5, 0, -3, 0, 8, 2, -19, 10, 12, -14, 10, 4, -3, 1, 11, -3,
+	11, 2, 1, -1, -12, 20, 9, 8, -12, -22, -55, 12, -10, -10, 1, 14, 5, -17, 24, 16, -7, 19, 10, 5, 12, 27, 6,
+	8, 9, -7, 9, 40, -3, 6, -4, -25, 5, 12, -1, 26, 51, 2, -9, -15, -27, 16, 29, -43, -22, 13, -12, 13, 12, -14,
+	6, 0, 14, 7, -3, 28, 4, 7, 10, 0, -10, 26, -28, -19, 14, 20, 14, -10, 13, 8, 15, 22, 13, 21, 0, 7, 1,
+	20, 29, 33, 3, -14, 45, 16, 35, 43, -3, -10, 51, -19, -9, 19, 30, 32, 24, 54, 51, 37, 61, 51, 47, 52, 69, 75,
+	4, 3, -3, 25, 16, 11, -14, 3, -2, 0, 1, 2, 14, 19, -18, -18, -10, -19, -7, -13, -1, -4, -23, 5, -14, 14, -3,
+	-11, -13, -10, -11, -4, -19, -21, -8, -12, 8, 14, -9, 20, 30, -18, -4, -18, -41, -17, -4, -23, -21, -21, -17, -9, 5, -8,
+	-21, -16, -21, 16, 16, -21, -14, -14, -29, 2, 5, -15, 14, 32, -10, -18, -11, -32, -29, -9, -44, -23, -29, -20, -9, 10, -18,
+	-20, -2, -28, -16, -16, -17, -23, -9, -39, -19, -17, -27, -10, 24, -19, -41, -32, -47, -20, 21, -78, -50, -39, -32, -12, 18, -34,
+	-1, -16, 18, -2, 15, 7, -9, -29, -9, 10, 24, 16, 13, 54, -7, -17, -29, -20, 8, 6, -34, -12, -13, 5, 4, -2, 7,
+	-3, -16, 8, -14, 26, -18, -11, -29, -5, 12, 16, 29, 8, 51, -13, -4, -9, 21, 6, -15, -4, -8, -13, -11, 6, 2, 42,
+	-20, -10, -10, -12, 18, 7, -18, -27, -32, -14, -7, -43, 15, 37, -1, -23, -44, -78, -34, -4, -43, -39, -29, -22, -10, -7, -10,
+	-12, -15, -14, 1, 17, -12, -29, -26, -17, 10, 19, -22, 22, 61, -4, -21, -23, -50, -12, -8, -39, -9, -19, -21, -8, -11, 16,
+	-17, -21, -10, -15, 31, -20, -9, -22, -14, 4, 10, 13, 13, 51, -23, -21, -29, -39, -13, -13, -29, -19, -19, -21, 18, 10, 12,
+	-14, -3, -15, 7, 16, -11, -6, -25, 0, -3, 5, -12, 21, 47, 5, -17, -20, -32, 5, -11, -22, -21, -21, -44, 16, 10, -3,
+	6, 2, 6, 1, 13, -12, -6, -10, 45, 1, 12, 13, 0, 52, -14, -9, -9, -12, 4, 6, -10, -8, 18, 16, 20, 18, 9,
+	2, 11, 24, 16, 31, 12, 14, 4, 9, 11, 27, 12, 7, 69, 14, 5, 10, 18, -2, 2, -7, -11, 10, 10, 18, 13, -1,
+	6, -5, 4, 2, 40, 1, 11, -21, 14, -3, 6, -14, 1, 75, -3, -8, -18, -34, 7, 42, -10, 16, 12, -3, 9, -1, -33,
+};
+
+PatternWeights::PatternWeights() : weights(BUILTIN, BUILTIN + PATTERN_COUNT)
+{
+	// Cells outside the board weigh nothing
+	weights.resize(PATTERN_COUNT + RING_CODES, 0);
+}
+
+shared_ptr<const PatternWeights> PatternWeights::builtin()
+{
+	static const shared_ptr<const PatternWeights> weights = make_shared<const PatternWeights>();
+	return weights;
+}
+
+shared_ptr<const PatternWeights> PatternWeights::load(const string &path)
+{
+	ifstream in(path);
+	if (!in)
+	{
+		throw runtime_error("can't read " + path);
+	}
+
+	shared_ptr<PatternWeights> loaded = make_shared<PatternWeights>();
+	fill(loaded->weights.begin(), loaded->weights.end(), 0);
+	string line;
+	for (int number = 1; getline(in, line); number++)
+	{
+		const size_t comment = line.find('#');
+		if (comment != string::npos)
+		{
+			line.erase(comment);
+		}
+		istringstream fields(line);
+		string pattern;
+		if (!(fields >> pattern))
+		{
+			continue;
+		}
+
+		int index = 0;
+		bool valid = pattern.size() == 7;
+		for (size_t i = 0; valid && i < pattern.size(); i++)
+		{
+			const char *symbol = (const char *)memchr(SYMBOL, pattern[i], 3);
+			valid = symbol != nullptr;
+			if (valid)
+			{
+				index += (int)(symbol - SYMBOL) * (i == 0 ? RING_CODES : DIGIT[i - 1]);
+			}
+		}
+		long long weight = 0;
+		string rest;
+		if (!valid || !(fields >> weight) || fields >> rest || weight < INT32_MIN || weight > INT32_MAX)
+		{
+			throw runtime_error(path + " line " + to_string(number) + " is not a pattern and a weight");
+		}
+		loaded->weights[index] = (int32_t)weight;
+	}
+	return loaded;
+}
+
+void PatternWeights::save(const string &path) const
+{
+	ofstream out(path);
+	out << "# Hex pattern weights: the cell, then the places north, north east, east,\n"
+		<< "# south, south west and west of it, as seen by the player joining north to\n"
+		<< "# south. '.' is blank, 'x' own and 'o' opponent, edges count as stones.\n";
+	for (int index = 0; index < PATTERN_COUNT; index++)
+	{
+		if (weights[index] != 0)
+		{
+			out << SYMBOL[index / RING_CODES];
+			for (int i = 0, code = index % RING_CODES; i < 6; i++, code /= 3)
+			{
+				out << SYMBOL[code % 3];
+			}
+			out << " " << weights[index] << "\n";
+		}
+	}
+	if (!out)
+	{
+		throw runtime_error("can't write " + path);
+	}
+}
+
+template <int N>
+PatternEvaluator<N>::PatternEvaluator() : n(0), width(0), offset(), cached(false), cached_hash(0), cached_weights(nullptr), totals_weights(nullptr), totals()
+{
+}
+
+template <int N>
+void PatternEvaluator<N>::prepare(const Geometry &geometry)
+{
+	n = geometry.V();
+	width = n + 2;
+
+	// Room past the last row for the vector loads of the last cells. North and
+	// south are the edges of the player the grid is for, the corners blank.
+	const size_t length = (size_t)(width * width + 32);
+	grid[0].assign(length, 0);
+	outside.assign(length, 3);
+	for (int i = 1; i <= n; i++)
+	{
+		grid[0][i] = 1;
+		grid[0][(n + 1) * width + i] = 1;
+		grid[0][i * width] = 2;
+		grid[0][i * width + n + 1] = 2;
+	}
+	grid[1] = grid[0];
+	for (int side = 0; side < 2; side++)
+	{
+		position[side].resize(geometry.cell_count());
+		codes[side].assign(length, 0);
+		filled[side] = Bits();
+	}
+	for (int row = 0; row < n; row++)
+	{
+		for (int col = 0; col < n; col++)
+		{
+			outside[(row + 1) * width + col + 1] = 0;
+			position[0][row * n + col] = (row + 1) * width + col + 1;
+			position[1][row * n + col] = (col + 1) * width + row + 1;
+		}
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		offset[i] = RING_ROW[i] * width + RING_COL[i];
+	}
+	cached = false;
+	totals_weights = nullptr;
+}
+
+template <int N>
+int PatternEvaluator<N>::score(const Geometry &geometry, const Bits &red, const Bits &blue, uint64_t hash, const PatternWeights &weights, int player)
+{
+	if (geometry.V() != n)
+	{
+		prepare(geometry);
+	}
+	if (cached && hash == cached_hash && &weights == cached_weights)
+	{
+		return totals[player];
+	}
+
+	const Bits changed = (red ^ filled[0]) | (blue ^ filled[1]);
+	if (totals_weights == &weights && changed.count() <= UPDATE_CELLS)
+	{
+		update(red, blue, changed, weights.table());
+	}
+	else
+	{
+		fill(red, blue);
+		evaluate(weights.table());
+		totals_weights = &weights;
+	}
+
+	cached = true;
+	cached_hash = hash;
+	cached_weights = &weights;
+	return totals[player];
+}
+
+template <int N>
+void PatternEvaluator<N>::count(const Geometry &geometry, const Bits &red, const Bits &blue, vector<int> &counts)
+{
+	if (geometry.V() != n)
+	{
+		prepare(geometry);
+	}
+	fill(red, blue);
+	cached = false;
+	totals_weights = nullptr;
+
+	const uint8_t *out = outside.data();
+	for (int side = 0; side < 2; side++)
+	{
+		const uint8_t *cells = grid[side].data();
+		for (int p = width + 1; p <= n * width + n; p++)
+		{
+			if (out[p] == 0)
+			{
+				int code = cells[p] * RING_CODES;
+				for (int i = 0; i < 6; i++)
+				{
+					code += cells[p + offset[i]] * DIGIT[i];
+				}
+				counts[code] += side == 0 ? 1 : -1;
+			}
+		}
+	}
+}
+
+template <int N>
+void PatternEvaluator<N>::fill(const Bits &red, const Bits &blue)
+{
+	// Positions a search scores one after another differ in a few stones, so
+	// only the cells that changed since the last one are written
+	const Bits changed = (red ^ filled[0]) | (blue ^ filled[1]);
+	changed.for_each([&](int cell)
+	{
+		const uint8_t color = red.test(cell) ? 1 : blue.test(cell) ? 2 : 0;
+		grid[0][position[0][cell]] = color;
+		grid[1][position[1][cell]] = color == 0 ? 0 : 3 - color;
+	});
+	filled[0] = red;
+	filled[1] = blue;
+}
+
+// Moves totals and codes from the position the grids hold to the one of red
+// and blue. A cell is the center of its own pattern and the place opposite
+// each of its six neighbours in theirs, so when its color changes each of
+// those codes changes by the difference in one digit.
+template <int N>
+void PatternEvaluator<N>::update(const Bits &red, const Bits &blue, const Bits &changed, const int32_t *table)
+{
+	const uint8_t *out = outside.data();
+	changed.for_each([&](int cell)
+	{
+		const uint8_t color = red.test(cell) ? 1 : blue.test(cell) ? 2 : 0;
+		for (int side = 0; side < 2; side++)
+		{
+			uint8_t *cells = grid[side].data();
+			int16_t *code = codes[side].data();
+			const int p = position[side][cell];
+			const uint8_t seen = side == 0 || color == 0 ? color : 3 - color;
+			const int change = seen - cells[p];
+			cells[p] = seen;
+
+			int total = totals[side] - table[code[p]];
+			code[p] = (int16_t)(code[p] + change * RING_CODES);
+			total += table[code[p]];
+			for (int i = 0; i < 6; i++)
+			{
+				const int q = p + offset[i];
+				if (out[q] == 0)
+				{
+					total -= table[code[q]];
+					code[q] = (int16_t)(code[q] + change * DIGIT[(i + 3) % 6]);
+					total += table[code[q]];
+				}
+			}
+			totals[side] = total;
+		}
+	});
+	filled[0] = red;
+	filled[1] = blue;
+}
+
+template <int N>
+void PatternEvaluator<N>::evaluate(const int32_t *table)
+{
+	// Every cell from the first on the board to the last, with the edge cells
+	// between the rows along for the ride and pointed at the zeros
+	const int first = width + 1;
+	const int last = n * width + n;
+	const uint8_t *out = outside.data();
+
+	for (int side = 0; side < 2; side++)
+	{
+		const uint8_t *cells = grid[side].data();
+		int16_t *code_of = codes[side].data();
+		int total = 0;
+#if defined(HEX_PATTERNS_AVX2)
+		const __m256i center_digit = _mm256_set1_epi16(RING_CODES);
+		__m256i digit[6];
+		for (int i = 0; i < 6; i++)
+		{
+			digit[i] = _mm256_set1_epi16((short)DIGIT[i]);
+		}
+		__m256i sum = _mm256_setzero_si256();
+		for (int p = first; p <= last; p += 16)
+		{
+			const __m128i center = _mm_or_si128(_mm_loadu_si128((const __m128i *)(cells + p)), _mm_loadu_si128((const __m128i *)(out + p)));
+			__m256i code = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(center), center_digit);
+			for (int i = 0; i < 6; i++)
+			{
+				const __m128i place = _mm_loadu_si128((const __m128i *)(cells + p + offset[i]));
+				code = _mm256_add_epi16(code, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(place), digit[i]));
+			}
+			_mm256_storeu_si256((__m256i *)(code_of + p), code);
+			const __m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(code));
+			const __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(code, 1));
+			sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32((const int *)table, low, 4));
+			sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32((const int *)table, high, 4));
+		}
+		__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+		total = _mm_cvtsi128_si32(half);
+#elif defined(HEX_PATTERNS_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i center_digit = _mm_set1_epi16(RING_CODES);
+		__m128i digit[6];
+		for (int i = 0; i < 6; i++)
+		{
+			digit[i] = _mm_set1_epi16((short)DIGIT[i]);
+		}
+		for (int p = first; p <= last; p += 16)
+		{
+			const __m128i center = _mm_or_si128(_mm_loadu_si128((const __m128i *)(cells + p)), _mm_loadu_si128((const __m128i *)(out + p)));
+			__m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(center, zero), center_digit);
+			__m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(center, zero), center_digit);
+			for (int i = 0; i < 6; i++)
+			{
+				const __m128i place = _mm_loadu_si128((const __m128i *)(cells + p + offset[i]));
+				low = _mm_add_epi16(low, _mm_mullo_epi16(_mm_unpacklo_epi8(place, zero), digit[i]));
+				high = _mm_add_epi16(high, _mm_mullo_epi16(_mm_unpackhi_epi8(place, zero), digit[i]));
+			}
+			_mm_storeu_si128((__m128i *)(code_of + p), low);
+			_mm_storeu_si128((__m128i *)(code_of + p + 8), high);
+			total += table[_mm_extract_epi16(low, 0)] + table[_mm_extract_epi16(low, 1)]
+				+ table[_mm_extract_epi16(low, 2)] + table[_mm_extract_epi16(low, 3)]
+				+ table[_mm_extract_epi16(low, 4)] + table[_mm_extract_epi16(low, 5)]
+				+ table[_mm_extract_epi16(low, 6)] + table[_mm_extract_epi16(low, 7)]
+				+ table[_mm_extract_epi16(high, 0)] + table[_mm_extract_epi16(high, 1)]
+				+ table[_mm_extract_epi16(high, 2)] + table[_mm_extract_epi16(high, 3)]
+				+ table[_mm_extract_epi16(high, 4)] + table[_mm_extract_epi16(high, 5)]
+				+ table[_mm_extract_epi16(high, 6)] + table[_mm_extract_epi16(high, 7)];
+		}
+#else
+		for (int p = first; p <= last; p++)
+		{
+			int code = (cells[p] | out[p]) * RING_CODES;
+			for (int i = 0; i < 6; i++)
+			{
+				code += cells[p + offset[i]] * DIGIT[i];
+			}
+			code_of[p] = (int16_t)code;
+			total += table[code];
+		}
+#endif
+		totals[side] = total;
+	}
+}
+
+shared_ptr<const PatternWeights> PatternWeights::fit(const vector<ArenaGame> &games, double &accuracy)
+{
+	// A pattern and its half turn, with the places three apart swapped, share
+	// the lower of their two indices
+	vector<int> tied(PATTERN_COUNT);
+	for (int index = 0; index < PATTERN_COUNT; index++)
+	{
+		int turned = index / RING_CODES * RING_CODES;
+		for (int i = 0; i < 6; i++)
+		{
+			turned += index % RING_CODES / DIGIT[(i + 3) % 6] % 3 * DIGIT[i];
+		}
+		tied[index] = min(index, turned);
+	}
+
+	// Every third position after the opening, since positions a move apart
+	// say much the same, as the patterns it has and how many of each
+	struct Sample
+	{
+		size_t begin; // of its patterns in features
+		size_t end;
+		int to_move;  // 1 for RED, -1 for BLUE
+		bool red_won;
+	};
+	vector<pair<int, int>> features;
+	vector<Sample> samples[2]; // fitted to and held out
+	vector<int> counts(PATTERN_COUNT, 0);
+	PatternEvaluator<0> patterns;
+	for (size_t g = 0; g < games.size(); g++)
+	{
+		const ArenaGame &game = games[g];
+		HexBoard<0> board(game.size);
+		for (size_t i = 0; i < game.moves.size(); i++)
+		{
+			const int cell = game.moves[i];
+			if (board.get_node_value(cell) != HexGame::BLANK)
+			{
+				throw invalid_argument("game " + to_string(g) + " plays " + HexGame::cell_name(cell / game.size, cell % game.size) + " twice");
+			}
+			board.make_index(i % 2 == 0 ? HexGame::RED : HexGame::BLUE, cell);
+			const int stones = (int)i + 1;
+			if (stones < game.opening || stones % 3 != 0 || i + 1 == game.moves.size())
+			{
+				continue;
+			}
+
+			patterns.count(board.tables(), board.stones(HexGame::RED), board.stones(HexGame::BLUE), counts);
+			for (int index = 0; index < PATTERN_COUNT; index++)
+			{
+				if (counts[index] != 0 && tied[index] != index)
+				{
+					counts[tied[index]] += counts[index];
+					counts[index] = 0;
+				}
+			}
+			Sample sample = { features.size(), 0, stones % 2 == 0 ? 1 : -1, game.winner == HexGame::RED };
+			for (int index = 0; index < PATTERN_COUNT; index++)
+			{
+				if (counts[index] != 0)
+				{
+					features.emplace_back(index, counts[index]);
+					counts[index] = 0;
+				}
+			}
+			sample.end = features.size();
+			samples[g % 10 == 9].push_back(sample);
+		}
+	}
+
+	// Stochastic gradient descent on the log loss, with a step for every
+	// weight that shrinks as its gradients add up (AdaGrad) and a little
+	// decay. The side to move gets a weight of its own, which the evaluator
+	// has no use for since both players are scored for the same position.
+	const int TO_MOVE = PATTERN_COUNT;
+	vector<double> weight(PATTERN_COUNT + 1, 0.0);
+	vector<double> squares(PATTERN_COUNT + 1, 1e-8);
+	auto predict = [&](const Sample &sample)
+	{
+		double z = weight[TO_MOVE] * sample.to_move;
+		for (size_t f = sample.begin; f < sample.end; f++)
+		{
+			z += weight[features[f].first] * features[f].second;
+		}
+		return z;
+	};
+	auto step = [&](int index, double gradient)
+	{
+		gradient += FIT_DECAY * weight[index];
+		squares[index] += gradient * gradient;
+		weight[index] -= FIT_RATE * gradient / sqrt(squares[index]);
+	};
+	vector<size_t> order(samples[0].size());
+	iota(order.begin(), order.end(), 0);
+	mt19937 random(1);
+	for (int epoch = 0; epoch < FIT_EPOCHS; epoch++)
+	{
+		shuffle(order.begin(), order.end(), random);
+		for (size_t s : order)
+		{
+			const Sample &sample = samples[0][s];
+			const double error = 1.0 / (1.0 + exp(-predict(sample))) - (sample.red_won ? 1.0 : 0.0);
+			for (size_t f = sample.begin; f < sample.end; f++)
+			{
+				step(features[f].first, error * features[f].second);
+			}
+			step(TO_MOVE, error * sample.to_move);
+		}
+	}
+
+	size_t right = 0;
+	for (const Sample &sample : samples[1])
+	{
+		right += (predict(sample) > 0.0) == sample.red_won;
+	}
+	accuracy = samples[1].empty() ? 0.0 : (double)right / samples[1].size();
+
+	shared_ptr<PatternWeights> fitted = make_shared<PatternWeights>();
+	for (int index = 0; index < PATTERN_COUNT; index++)
+	{
+		fitted->weights[index] = (int32_t)lround(FIT_SCALE * weight[tied[index]]);
+	}
+	return fitted;
+}
+
+static const char *const USAGE =
+	"Hex patterns [out=patterns.txt] [games=<file>,<file>,...]\n"
+	"  writes the built in pattern weights, or weights fitted to the games\n"
+	"  of arena results files\n";
+
+int run_patterns(int argc, char *argv[])
+{
+	string path = "patterns.txt";
+	vector<string> game_paths;
+	for (int i = 0; i < argc; i++)
+	{
+		const string argument = argv[i];
+		if (argument.compare(0, 4, "out=") == 0)
+		{
+			path = argument.substr(4);
+		}
+		else if (argument.compare(0, 6, "games=") == 0)
+		{
+			stringstream list(argument.substr(6));
+			string name;
+			while (getline(list, name, ','))
+			{
+				if (!name.empty()) game_paths.push_back(name);
+			}
+		}
+		else
+		{
+			cerr << "Unknown patterns setting " << argument << "\n" << USAGE;
+			return 1;
+		}
+	}
+
+	try
+	{
+		if (game_paths.empty())
+		{
+			PatternWeights().save(path);
+			cout << "Wrote the built in pattern weights to " << path << "\n";
+			return 0;
+		}
+
+		vector<ArenaGame> games;
+		for (const string &game_path : game_paths)
+		{
+			vector<ArenaGame> read = read_arena_games(game_path);
+			games.insert(games.end(), read.begin(), read.end());
+		}
+		const auto start = chrono::steady_clock::now();
+		double accuracy = 0.0;
+		PatternWeights::fit(games, accuracy)->save(path);
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		printf("Fitted to %zu games in %.1f s, picks the winner of %.1f%% of the held out positions\n",
+			games.size(), seconds, 100.0 * accuracy);
+		cout << "Wrote the weights to " << path << "\n";
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+#define INSTANTIATE(N) template class PatternEvaluator<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
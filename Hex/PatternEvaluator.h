@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "HexGeometry.h"
+
+struct ArenaGame;
+
+// Weights of the local patterns PatternEvaluator scores a board with. A
+// pattern is a cell and the six places around it, seen by the player it is
+// scored for as if they joined north to south: the cell is blank, own, or
+// opponent, and so is every place, with the edges counting as stones of the
+// player they belong to and the corners as blank. The places go round in the
+// order of HexGeometry's rings, north, north east, east, south, south west
+// and west.
+//
+// In a file a pattern is written as seven characters, the cell and then the
+// places, using '.' for blank, 'x' for own and 'o' for opponent, followed by
+// its weight:
+//
+//   # an own stone with an own stone to the north
+//   xx..... 9
+//
+// Text after '#' is a comment, and a pattern that isn't listed weighs 0.
+class PatternWeights
+{
+public:
+	// Patterns for a cell of each color, places in base 3 like InferiorCells
+	static const int RING_CODES = 729;
+	static const int PATTERN_COUNT = 3 * RING_CODES;
+
+	// The built in weights, which fit() found from games of two-distance
+	// minimax against itself
+	PatternWeights();
+
+	// One copy of the built in weights for every board to share
+	static std::shared_ptr<const PatternWeights> builtin();
+
+	// Throws runtime_error when the file can't be read or a line isn't a pattern
+	static std::shared_ptr<const PatternWeights> load(const std::string &path);
+
+	// Weights that predict the winners of the games from their positions by
+	// logistic regression: the chance RED wins grows with the weights of the
+	// patterns RED sees less those BLUE sees. A pattern and its half turn get
+	// the same weight, since a board turned around is the same game. Every
+	// tenth game is kept out of the fit, and accuracy is how often the
+	// weights pick the winner of its positions.
+	static std::shared_ptr<const PatternWeights> fit(const std::vector<ArenaGame> &games, double &accuracy);
+
+	// Writes every pattern with a weight other than 0, one per line
+	void save(const std::string &path) const;
+
+	// Indexed by center * RING_CODES + ring, with one more block of zeros
+	// after the patterns for the cells outside the board
+	inline const int32_t *table() const { return weights.data(); };
+
+private:
+	std::vector<int32_t> weights;
+};
+
+// Scores a board by adding up the weight of the pattern around every cell, for
+// each player. The board is copied into a byte grid with a border of edge
+// cells, once as RED sees it and once with the colors swapped for BLUE, so the
+// six places around any cell are at fixed offsets and a row of cells turns
+// into pattern codes with a few multiplies and adds, sixteen cells at a time.
+// With AVX2 the weights of those are gathered in two instructions, with SSE2
+// they are read one by one, and without either the whole thing is a plain
+// loop over the cells.
+//
+// BLUE's grid is RED's read with rows and columns swapped, which lines its
+// edges up with RED's, so the same weights serve both players.
+//
+// The scores of the last position are kept, so asking for the second player
+// of a position costs nothing. When the next position differs from it in a
+// few stones, as the leaves of a search do, only the seven patterns around
+// each of those stones change: the scan keeps the pattern code of every cell,
+// and a stone moves seven codes by one digit and swaps their weights. The
+// whole board is only scanned for the first position and after bigger jumps.
+// Like ConnectionEvaluator it keeps buffers between calls and one evaluator
+// must not be used by two threads at once.
+template <int N>
+class PatternEvaluator
+{
+public:
+	typedef HexGeometry<N> Geometry;
+	typedef typename Geometry::Bits Bits;
+
+	PatternEvaluator();
+
+	// Sum of the weights around every cell for player (0 for RED, 1 for BLUE).
+	// hash must tell apart positions evaluated with the same weights.
+	int score(const Geometry &geometry, const Bits &red, const Bits &blue, uint64_t hash, const PatternWeights &weights, int player);
+
+	// Adds one to counts for every cell that RED sees each pattern around and
+	// takes one off for every cell BLUE does, with counts in table() order
+	void count(const Geometry &geometry, const Bits &red, const Bits &blue, std::vector<int> &counts);
+
+private:
+	void prepare(const Geometry &geometry);
+	void fill(const Bits &red, const Bits &blue);
+	void evaluate(const int32_t *table);
+	void update(const Bits &red, const Bits &blue, const Bits &changed, const int32_t *table);
+
+	int n;
+	int width; // of a grid row, the board plus an edge cell at each end
+
+	// Grids as RED and as BLUE sees them (1 own, 2 opponent), the stones of
+	// RED and BLUE they were last filled with, and a grid that is 3 outside
+	// the board, which ORed into a cell points it at the zeros past the patterns
+	std::vector<uint8_t> grid[2];
+	Bits filled[2];
+	std::vector<uint8_t> outside;
+	std::vector<int> position[2]; // of every cell in each grid
+	std::vector<int16_t> codes[2]; // pattern of every cell in each grid, as of the last full scan and updates since
+	int offset[6];                // of the places around a cell
+
+	bool cached;
+	uint64_t cached_hash;
+	const PatternWeights *cached_weights;
+	const PatternWeights *totals_weights; // what totals add up for the grids, null when they don't
+	int totals[2];
+};
+
+// Hex patterns [key=value ...], writes the built in weights or fits new ones,
+// see the usage text in PatternEvaluator.cpp
+int run_patterns(int argc, char *argv[]);
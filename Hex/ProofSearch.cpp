@@ -0,0 +1,712 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "InferiorCells.h"
+#include "ProofSearch.h"
+using namespace std;
+
+static const char *const USAGE =
+	"Hex solve [key=value ...]\n"
+	"  size=7 moves=a1,b2,... time=60000 nodes=0 threads=<cores> table=256 prune=1\n"
+	"  moves are played RED first, time and nodes of 0 mean no limit\n";
+
+static const uint32_t INFINITE = ProofTable::INFINITE;
+
+// Threads check the clock and hand over their node count this often
+static const uint64_t CHECK_NODES = 1024;
+
+static const size_t BUSY_SLOTS = 1 << 16;
+
+static inline uint32_t add_numbers(uint32_t a, uint32_t b)
+{
+	const uint64_t sum = (uint64_t)a + b;
+	return sum < INFINITE ? (uint32_t)sum : INFINITE;
+}
+
+// Threshold for a child that has to stay below its best sibling, a quarter
+// above the sibling so the search stays in the child a little longer
+static inline uint32_t stretch(uint32_t sibling)
+{
+	return add_numbers(sibling, sibling / 4 + 1);
+}
+
+template <int N>
+ProofSearch<N>::Worker::Worker(const HexBoard<N> &board) : board(board), nodes(0), reported(0)
+{
+	children.resize(board.tables().cell_count() + 1);
+	through[HexGame::RED].resize(board.tables().cell_count());
+	through[HexGame::BLUE].resize(board.tables().cell_count());
+	for (vector<Child> &list : children)
+	{
+		list.reserve(board.tables().cell_count());
+	}
+}
+
+template <int N>
+ProofSearch<N>::ProofSearch(const HexBoard<N> &board, ProofTable *table, int threads) : board(board), table(table), threads(threads > 1 ? threads : 1), root_moves(0), busy(threads > 1 ? BUSY_SLOTS : 0), has_deadline(false), node_limit(0), node_total(0), stopped(false)
+{
+}
+
+// The cells next to the player's stones joined to each of their edges,
+// counting the edge itself. A blank cell in both wins at once.
+template <int N>
+struct edge_reach
+{
+	typedef typename HexBoard<N>::Bits Bits;
+
+	edge_reach(const HexGeometry<N> &g, HexGame::Player player, const Bits &own)
+	{
+		const Bits &start = player == HexGame::RED ? g.north_edge : g.west_edge;
+		const Bits &goal = player == HexGame::RED ? g.south_edge : g.east_edge;
+		from_start = g.dilate(g.flood_fill(start & own, own)) | start;
+		from_goal = g.dilate(g.flood_fill(goal & own, own)) | goal;
+	}
+
+	inline Bits winning(const Bits &blank) const { return from_start & from_goal & blank; };
+
+	Bits from_start;
+	Bits from_goal;
+};
+
+// Finds whether the player's groups join their two edges through links that
+// each have two or more blank cells that would join them on their own: the
+// cells two groups both touch, or a group's cells on an edge row. When no two
+// links share a cell the player answers every intrusion in the same link, so
+// they have won already, whoever moves. The chain is looked for depth first
+// over the groups, up to a fixed number of steps, so a crowded board may go
+// unrecognized but never the other way round.
+template <int N>
+class virtual_connection
+{
+public:
+	typedef typename HexBoard<N>::Bits Bits;
+
+	virtual_connection(const HexGeometry<N> &g, HexGame::Player player, const Bits &own, const Bits &blank) : total(0), steps(0), found(false)
+	{
+		const Bits &start = player == HexGame::RED ? g.north_edge : g.west_edge;
+		const Bits &goal = player == HexGame::RED ? g.south_edge : g.east_edge;
+		Bits remaining = own;
+		while (remaining.any())
+		{
+			if (total == MAX_GROUPS)
+			{
+				return;
+			}
+			Bits seed;
+			seed.set(remaining.first());
+			const Bits cells = g.flood_fill(seed, own);
+			remaining.clear(cells);
+			group &next = groups[total++];
+			next.border = g.dilate(cells) & blank;
+			next.to_start = cells.intersects(start) ? Bits() : next.border & start;
+			next.to_goal = cells.intersects(goal) ? Bits() : next.border & goal;
+			next.on_start = cells.intersects(start) || next.to_start.count() > 1;
+			next.on_goal = cells.intersects(goal) || next.to_goal.count() > 1;
+			next.on_path = false;
+		}
+		for (int i = 0; i < total && !found; i++)
+		{
+			found = groups[i].on_start && extend(i, groups[i].to_start);
+		}
+	}
+
+	inline bool connected() const { return found; };
+
+	// The cells of the links, any of which keeps the connection when filled
+	inline const Bits &cells() const { return carrier; };
+
+private:
+	static const int MAX_GROUPS = 32;
+	static const int MAX_STEPS = 256;
+
+	struct group
+	{
+		Bits border;
+		Bits to_start; // cells on the edge rows next to the group, empty when it is on the edge
+		Bits to_goal;
+		bool on_start; // on the edge or linked to it
+		bool on_goal;
+		bool on_path;
+	};
+
+	bool extend(int from, const Bits &used)
+	{
+		if (++steps > MAX_STEPS)
+		{
+			return false;
+		}
+		group &here = groups[from];
+		if (here.on_goal && !here.to_goal.intersects(used))
+		{
+			carrier = used | here.to_goal;
+			return true;
+		}
+		here.on_path = true;
+		for (int next = 0; next < total; next++)
+		{
+			const Bits link = here.border & groups[next].border;
+			if (!groups[next].on_path && link.count() > 1 && !link.intersects(used) && extend(next, used | link))
+			{
+				return true;
+			}
+		}
+		here.on_path = false;
+		return false;
+	}
+
+	group groups[MAX_GROUPS];
+	int total;
+	int steps;
+	bool found;
+	Bits carrier;
+};
+
+template <int N>
+typename ProofSearch<N>::Outcome ProofSearch<N>::expand(Worker &worker, HexGame::Player player, vector<Child> &children, int &winning_move) const
+{
+	typedef edge_reach<N> Reach;
+	const HexBoard<N> &board = worker.board;
+	const HexGeometry<N> &g = board.tables();
+	const HexGame::Player opponent = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	const Bits &own = board.stones(player);
+	const Bits &other = board.stones(opponent);
+	const Bits blank = board.blank_cells();
+
+	winning_move = -1;
+	const Reach mine(g, player, own);
+	const Bits wins = mine.winning(blank);
+	if (wins.any())
+	{
+		winning_move = wins.first();
+		return WON;
+	}
+	const Reach theirs(g, opponent, other);
+	const Bits threats = theirs.winning(blank);
+	if (threats.count() > 1)
+	{
+		return LOST;
+	}
+
+	const virtual_connection<N> their_chain(g, opponent, other, blank);
+	if (their_chain.connected())
+	{
+		return LOST;
+	}
+
+	// A chain of our own, or a move that makes two threats, wins when there
+	// is no threat to answer
+	Bits allowed = threats;
+	if (threats.none())
+	{
+		const virtual_connection<N> our_chain(g, player, own, blank);
+		if (our_chain.connected())
+		{
+			winning_move = our_chain.cells().first();
+			return WON;
+		}
+		((mine.from_start | mine.from_goal) & blank).for_each([&](int cell)
+		{
+			if (winning_move < 0)
+			{
+				Bits more = own;
+				more.set(cell);
+				Bits rest = blank;
+				rest.reset(cell);
+				if (Reach(g, player, more).winning(rest).count() > 1)
+				{
+					winning_move = cell;
+				}
+			}
+		});
+		if (winning_move >= 0)
+		{
+			return WON;
+		}
+
+		// Every opponent move that would make two threats or a chain has to be
+		// stopped, by taking its cell or a cell the threats or the chain need.
+		// A move that makes a threat of its own is the other way out, since the
+		// opponent has to answer that first. Only cells next to a group joined
+		// to an edge can make a threat.
+		allowed = blank;
+		bool forced = false;
+		((theirs.from_start | theirs.from_goal) & blank).for_each([&](int cell)
+		{
+			Bits more = other;
+			more.set(cell);
+			Bits rest = blank;
+			rest.reset(cell);
+			Bits stop = Reach(g, opponent, more).winning(rest);
+			if (stop.count() > 1)
+			{
+				stop.set(cell);
+				allowed &= stop;
+				forced = true;
+			}
+		});
+		Bits joining = g.dilate(other);
+		joining |= opponent == HexGame::RED ? g.north_edge | g.south_edge : g.west_edge | g.east_edge;
+		joining &= allowed;
+		joining.for_each([&](int cell)
+		{
+			Bits more = other;
+			more.set(cell);
+			Bits rest = blank;
+			rest.reset(cell);
+			const virtual_connection<N> chain(g, opponent, more, rest);
+			if (chain.connected())
+			{
+				Bits stop = chain.cells();
+				stop.set(cell);
+				allowed &= stop;
+				forced = true;
+			}
+		});
+		if (forced)
+		{
+			Bits counters = (mine.from_start | mine.from_goal) & blank;
+			counters.clear(allowed);
+			counters.for_each([&](int cell)
+			{
+				Bits more = own;
+				more.set(cell);
+				Bits rest = blank;
+				rest.reset(cell);
+				if (Reach(g, player, more).winning(rest).any())
+				{
+					allowed.set(cell);
+				}
+			});
+			if (allowed.none())
+			{
+				return LOST;
+			}
+		}
+	}
+
+	Bits candidates = allowed;
+	if (board.prunes_inferior_cells() && threats.none())
+	{
+		candidates.clear(inferior_cells(board));
+		if (candidates.none())
+		{
+			candidates = allowed;
+		}
+	}
+	const uint64_t base = board.hash() ^ (opponent == HexGame::BLUE ? g.zobrist_side : 0);
+	const int total = board.blank_count();
+	const int *blanks = board.blank_list();
+	children.clear();
+	for (int i = 0; i < total; i++)
+	{
+		if (candidates.test(blanks[i]))
+		{
+			children.push_back({ blanks[i], base ^ g.zobrist(player, blanks[i]), 1, 1 });
+		}
+	}
+	estimate(worker, player, children);
+	return OPEN;
+}
+
+// First guesses for children that aren't in the table yet, from the shortest
+// paths through each cell. The move shortens the mover's path to the one
+// through it, and lengthens the opponent's path when it was on every one of
+// their shortest paths as far as this can tell. Cubing spreads the guesses
+// far enough apart to steer the search, which a plain difference doesn't.
+template <int N>
+void ProofSearch<N>::estimate(Worker &worker, HexGame::Player player, vector<Child> &children) const
+{
+	const HexGame::Player opponent = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	const HexBoard<N> &board = worker.board;
+	const HexGeometry<N> &g = board.tables();
+	int lengths[2];
+	for (int side = HexGame::RED; side <= HexGame::BLUE; side++)
+	{
+		const Bits &start = side == HexGame::RED ? g.north_edge : g.west_edge;
+		const Bits &goal = side == HexGame::RED ? g.south_edge : g.east_edge;
+		const HexGame::Player rival = side == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+		lengths[side] = worker.connection.shortest_paths_through(g, board.stones((HexGame::Player)side), board.stones(rival), start, goal, worker.through[side].data());
+	}
+	const int *own = worker.through[player].data();
+	const int *other = worker.through[opponent].data();
+	for (Child &child : children)
+	{
+		ProofTable::Entry entry;
+		if (table->probe(child.key, entry))
+		{
+			child.proof = entry.proof;
+			child.disproof = entry.disproof;
+			continue;
+		}
+		const uint32_t mover = own[child.move] - 1;
+		const uint32_t rest = lengths[opponent] + (other[child.move] == lengths[opponent] ? 1 : 0);
+		child.proof = rest * rest * rest;
+		child.disproof = mover * mover * mover;
+	}
+}
+
+template <int N>
+uint32_t ProofSearch<N>::busy_weight(uint64_t key) const
+{
+	return busy.empty() ? 0 : busy[key & (BUSY_SLOTS - 1)].load(memory_order_relaxed);
+}
+
+template <int N>
+bool ProofSearch<N>::out_of_budget(Worker &worker)
+{
+	if (worker.nodes - worker.reported >= CHECK_NODES)
+	{
+		const uint64_t total = node_total += worker.nodes - worker.reported;
+		worker.reported = worker.nodes;
+		if ((node_limit > 0 && total >= node_limit) || (has_deadline && chrono::steady_clock::now() >= deadline))
+		{
+			stopped = true;
+		}
+	}
+	return stopped;
+}
+
+template <int N>
+void ProofSearch<N>::search(Worker &worker, int ply, HexGame::Player player, uint64_t key, uint32_t proof_limit, uint32_t disproof_limit, ProofTable::Entry &node)
+{
+	const HexGame::Player opponent = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	const uint64_t nodes_before = worker.nodes++;
+
+	vector<Child> &children = worker.children[ply];
+	int winning_move;
+	const Outcome outcome = expand(worker, player, children, winning_move);
+	if (outcome != OPEN)
+	{
+		node.proof = outcome == WON ? 0 : INFINITE;
+		node.disproof = outcome == WON ? INFINITE : 0;
+		node.move = winning_move;
+		node.work = 1;
+		table->store(key, node);
+		return;
+	}
+
+	node.move = -1;
+	for (;;)
+	{
+		// Other threads may have moved any child on since the last look
+		uint32_t proof = INFINITE;
+		uint32_t disproof = 0;
+		for (Child &child : children)
+		{
+			ProofTable::Entry entry;
+			if (table->probe(child.key, entry))
+			{
+				child.proof = entry.proof;
+				child.disproof = entry.disproof;
+			}
+			proof = min(proof, child.disproof);
+			disproof = add_numbers(disproof, child.proof);
+		}
+		node.proof = proof;
+		node.disproof = disproof;
+		if (proof == 0 || disproof == 0 || proof >= proof_limit || disproof >= disproof_limit || out_of_budget(worker))
+		{
+			break;
+		}
+
+		// The child with the smallest disproof number, and the next smallest
+		// for its threshold. Busy children count as harder, unless that picks a
+		// child that is over the limit already, which would get nowhere.
+		int best = -1;
+		uint32_t best_value = INFINITE;
+		uint32_t second_value = INFINITE;
+		for (int pass = threads > 1 ? 0 : 1; pass < 2 && best < 0; pass++)
+		{
+			best_value = INFINITE;
+			second_value = INFINITE;
+			for (int i = 0; i < (int)children.size(); i++)
+			{
+				uint32_t value = children[i].disproof;
+				if (pass == 0)
+				{
+					value = add_numbers(value, busy_weight(children[i].key) * (value / 2 + 1));
+				}
+				if (best < 0 || value < best_value)
+				{
+					second_value = best_value;
+					best_value = value;
+					best = i;
+				}
+				else if (value < second_value)
+				{
+					second_value = value;
+				}
+			}
+			if (pass == 0 && children[best].disproof >= proof_limit)
+			{
+				best = -1;
+			}
+		}
+
+		Child &child = children[best];
+		const uint32_t child_proof_limit = disproof_limit - (disproof - child.proof);
+		const uint32_t child_disproof_limit = min(proof_limit, stretch(second_value));
+
+		ProofTable::Entry result;
+		worker.board.make_index(player, child.move);
+		if (!busy.empty())
+		{
+			busy[child.key & (BUSY_SLOTS - 1)]++;
+		}
+		search(worker, ply + 1, opponent, child.key, child_proof_limit, child_disproof_limit, result);
+		if (!busy.empty())
+		{
+			busy[child.key & (BUSY_SLOTS - 1)]--;
+		}
+		worker.board.unmake_index();
+		child.proof = result.proof;
+		child.disproof = result.disproof;
+		node.move = child.move;
+	}
+
+	if (node.proof == 0)
+	{
+		for (const Child &child : children)
+		{
+			if (child.disproof == 0)
+			{
+				node.move = child.move;
+				break;
+			}
+		}
+	}
+	const uint64_t work = worker.nodes - nodes_before;
+	node.work = work < INFINITE ? (uint32_t)work : INFINITE;
+	table->store(key, node);
+}
+
+template <int N>
+uint64_t ProofSearch<N>::proof_size(Worker &worker, HexGame::Player player, unordered_set<uint64_t> &seen)
+{
+	const HexGame::Player opponent = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	HexBoard<N> &board = worker.board;
+	const uint64_t key = board.hash() ^ (player == HexGame::BLUE ? board.tables().zobrist_side : 0);
+	if (!seen.insert(key).second)
+	{
+		return 0;
+	}
+
+	vector<Child> children;
+	int winning_move;
+	if (expand(worker, player, children, winning_move) != OPEN)
+	{
+		return 1;
+	}
+
+	ProofTable::Entry entry;
+	if (!table->probe(key, entry) || (entry.proof != 0 && entry.disproof != 0))
+	{
+		search(worker, board.move_count() - root_moves, player, key, INFINITE, INFINITE, entry);
+	}
+
+	uint64_t size = 1;
+	if (entry.proof == 0)
+	{
+		board.make_index(player, entry.move);
+		size += proof_size(worker, opponent, seen);
+		board.unmake_index();
+	}
+	else
+	{
+		for (const Child &child : children)
+		{
+			board.make_index(player, child.move);
+			size += proof_size(worker, opponent, seen);
+			board.unmake_index();
+		}
+	}
+	return size;
+}
+
+template <int N>
+proof_result ProofSearch<N>::solve(HexGame::Player player, int milliseconds, uint64_t max_nodes)
+{
+	const auto start = chrono::steady_clock::now();
+	const HexGame::Player opponent = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	proof_result result = { board.check_winner(), -1, 0, 0, 0.0 };
+	if (result.winner != HexGame::BLANK)
+	{
+		return result;
+	}
+
+	has_deadline = milliseconds > 0;
+	deadline = start + chrono::milliseconds(milliseconds);
+	node_limit = max_nodes;
+	node_total = 0;
+	stopped = false;
+	root_moves = board.move_count();
+	const uint64_t key = board.hash() ^ (player == HexGame::BLUE ? board.tables().zobrist_side : 0);
+
+	vector<unique_ptr<Worker>> workers;
+	for (int i = 0; i < threads; i++)
+	{
+		workers.emplace_back(new Worker(board));
+	}
+	auto run = [&](Worker &worker)
+	{
+		ProofTable::Entry root;
+		search(worker, 0, player, key, INFINITE, INFINITE, root);
+		stopped = true;
+	};
+	vector<thread> helpers;
+	for (int i = 1; i < threads; i++)
+	{
+		helpers.emplace_back(run, ref(*workers[i]));
+	}
+	run(*workers[0]);
+	for (thread &helper : helpers)
+	{
+		helper.join();
+	}
+	for (const unique_ptr<Worker> &worker : workers)
+	{
+		node_total += worker->nodes - worker->reported;
+		worker->reported = worker->nodes;
+	}
+
+	ProofTable::Entry root;
+	if (table->probe(key, root) && (root.proof == 0 || root.disproof == 0))
+	{
+		result.winner = root.proof == 0 ? player : opponent;
+		result.move = root.proof == 0 ? root.move : -1;
+
+		// Counting the proof may have to solve parts of it again, which gets
+		// no budget, since a proof once found is always found again
+		has_deadline = false;
+		node_limit = 0;
+		stopped = false;
+		unordered_set<uint64_t> seen;
+		result.proof_size = proof_size(*workers[0], player, seen);
+		node_total += workers[0]->nodes - workers[0]->reported;
+	}
+	result.nodes = node_total;
+	result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+struct solver_settings
+{
+	int size;
+	vector<string> moves;
+	int move_time_ms;
+	uint64_t max_nodes;
+	int threads;
+	size_t table_megabytes;
+	bool pruning;
+};
+
+template <int N>
+static void solve_position(const solver_settings &settings)
+{
+	HexBoard<N> board(settings.size);
+	board.set_pruning(settings.pruning);
+	HexGame::Player player = HexGame::RED;
+	for (const string &name : settings.moves)
+	{
+		int row, col;
+		if (!HexGame::parse_cell(name, row, col) || row >= settings.size || col >= settings.size || board.get_node_value(row, col) != HexGame::BLANK)
+		{
+			throw invalid_argument("Can't play " + name + " on this board");
+		}
+		board.make_index(player, row, col);
+		player = player == HexGame::RED ? HexGame::BLUE : HexGame::RED;
+	}
+	const char *const names[] = { "RED", "BLUE" };
+
+	ProofTable table(settings.table_megabytes);
+	if (table.megabytes() < settings.table_megabytes)
+	{
+		cout << "Only " << table.megabytes() << " MB were free for the table" << endl;
+	}
+	ProofSearch<N> search(board, &table, settings.threads);
+	const proof_result result = search.solve(player, settings.move_time_ms, settings.max_nodes);
+
+	cout << names[player] << " to move on " << settings.size << "x" << settings.size << " after " << settings.moves.size() << " moves: ";
+	if (result.winner == HexGame::BLANK)
+	{
+		cout << "unsolved" << endl;
+	}
+	else
+	{
+		cout << names[result.winner] << " wins";
+		if (result.move >= 0)
+		{
+			cout << " with " << HexGame::cell_name(result.move / settings.size, result.move % settings.size);
+		}
+		cout << ", proof of " << result.proof_size << " positions" << endl;
+	}
+	cout << result.nodes << " positions expanded in " << result.milliseconds / 1000 << " s, "
+		<< (uint64_t)(result.nodes / (result.milliseconds / 1000 + 1e-9)) << " per second, "
+		<< table.used_count() * 100 / table.entry_count() << "% of a " << table.megabytes() << " MB table used, "
+		<< table.evictions() << " evictions" << endl;
+}
+
+int run_solver(int argc, char *argv[])
+{
+	const int cores = (int)thread::hardware_concurrency();
+	solver_settings settings = { 7, {}, 60000, 0, cores > 0 ? cores : 1, 256, true };
+	for (int i = 0; i < argc; i++)
+	{
+		const string argument = argv[i];
+		const size_t equals = argument.find('=');
+		const string key = argument.substr(0, equals);
+		const string value = equals == string::npos ? "" : argument.substr(equals + 1);
+
+		if (key == "size") settings.size = atoi(value.c_str());
+		else if (key == "time") settings.move_time_ms = atoi(value.c_str());
+		else if (key == "nodes") settings.max_nodes = strtoull(value.c_str(), nullptr, 10);
+		else if (key == "threads") settings.threads = atoi(value.c_str());
+		else if (key == "table") settings.table_megabytes = strtoul(value.c_str(), nullptr, 10);
+		else if (key == "prune") settings.pruning = atoi(value.c_str()) != 0;
+		else if (key == "moves")
+		{
+			stringstream list(value);
+			string name;
+			while (getline(list, name, ','))
+			{
+				if (!name.empty()) settings.moves.push_back(name);
+			}
+		}
+		else
+		{
+			cerr << "Unknown solver setting " << argument << "\n" << USAGE;
+			return 1;
+		}
+	}
+	if (settings.size < 1 || settings.size > HexGeometry<0>::MAX_SIZE)
+	{
+		cerr << "The size must be from 1 to " << HexGeometry<0>::MAX_SIZE << "\n" << USAGE;
+		return 1;
+	}
+
+	try
+	{
+		switch (settings.size)
+		{
+#define SOLVE(N) case N: solve_position<N>(settings); break;
+		HEX_FIXED_SIZES(SOLVE)
+#undef SOLVE
+		default:
+			solve_position<0>(settings);
+		}
+	}
+	catch (const exception &error)
+	{
+		cerr << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+#define INSTANTIATE(N) template class ProofSearch<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
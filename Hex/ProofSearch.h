@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include "HexBoard.h"
+#include "ProofTable.h"
+
+// What a proof search found out about a position
+struct proof_result {
+	HexGame::Player winner; // BLANK when the budget ran out first
+	int move;               // a winning move when the player to move wins, else -1
+	uint64_t nodes;         // positions expanded by all threads
+	uint64_t proof_size;    // distinct positions in the proof, 0 when unsolved
+	double milliseconds;
+};
+
+// Solves positions exactly with depth-first proof-number search (df-pn).
+//
+// Numbers are kept from the point of view of the player to move: the proof
+// number estimates how much is left to show they win, the disproof number how
+// much to show they lose. A position's proof number is the smallest disproof
+// number of its children and its disproof number the sum of their proof
+// numbers. The search goes down the child with the smallest disproof number
+// until the numbers pass thresholds handed down from the parent, and keeps
+// what it found in a ProofTable. Thresholds are stretched by a quarter (the
+// 1 + epsilon trick) so the search doesn't keep leaving and reentering two
+// subtrees whose numbers are close. New children start from guesses made
+// from the shortest paths of both players.
+//
+// Expanding a position settles it outright when it can: a cell that wins at
+// once, or a move that makes two such cells, proves it, two winning cells for
+// the opponent disprove it, and so does a chain of groups joined by links of
+// two or more cells with no cell in two links, since its owner answers every
+// intrusion. Otherwise only the moves that stop every opponent move making
+// two winning cells or such a chain are tried, and dead and captured cells
+// are left out like in MinimaxSearch.
+//
+// Every thread searches from the root on its own copy of the board and shares
+// the table. A thread going down a child marks it busy, and the others see a
+// busy child as harder than it is, which spreads them over the tree.
+template <int N>
+class ProofSearch
+{
+public:
+	ProofSearch(const HexBoard<N> &board, ProofTable *table, int threads = 1);
+
+	// Solves the position for player to move within the time budget and node
+	// budget, 0 meaning no limit for either
+	proof_result solve(HexGame::Player player, int milliseconds, uint64_t max_nodes = 0);
+
+	// Stops a search running on another thread
+	inline void stop() { stopped = true; };
+
+private:
+	typedef typename HexBoard<N>::Bits Bits;
+
+	struct Child
+	{
+		int move;
+		uint64_t key;
+		uint32_t proof;
+		uint32_t disproof;
+	};
+
+	// What expand() learned without searching any further
+	enum Outcome { OPEN, WON, LOST };
+
+	struct Worker
+	{
+		explicit Worker(const HexBoard<N> &board);
+
+		HexBoard<N> board;
+		uint64_t nodes;    // expanded by this worker so far
+		uint64_t reported; // of nodes, already added to node_total
+		std::vector<std::vector<Child>> children; // one list per ply
+		ConnectionEvaluator<N> connection;
+		std::vector<int> through[2];
+	};
+
+	Outcome expand(Worker &worker, HexGame::Player player, std::vector<Child> &children, int &winning_move) const;
+	void search(Worker &worker, int ply, HexGame::Player player, uint64_t key, uint32_t proof_limit, uint32_t disproof_limit, ProofTable::Entry &node);
+	void estimate(Worker &worker, HexGame::Player player, std::vector<Child> &children) const;
+	uint32_t busy_weight(uint64_t key) const;
+	bool out_of_budget(Worker &worker);
+
+	// Positions in the proof of what the table says about the root, solving
+	// again whatever dropped out of the table in the meantime
+	uint64_t proof_size(Worker &worker, HexGame::Player player, std::unordered_set<uint64_t> &seen);
+
+	const HexBoard<N> &board;
+	ProofTable *table;
+	int threads;
+	int root_moves;
+
+	// How many threads are below each child, in slots picked by the low bits
+	// of its key. Two children sharing a slot only means a little less spread.
+	std::vector<std::atomic<uint8_t>> busy;
+
+	std::chrono::steady_clock::time_point deadline;
+	bool has_deadline;
+	uint64_t node_limit;
+	std::atomic<uint64_t> node_total;
+	std::atomic<bool> stopped;
+};
+
+// Hex solve [key=value ...], see the usage text in ProofSearch.cpp
+int run_solver(int argc, char *argv[]);
@@ -0,0 +1,123 @@
+#include <new>
+#include "ProofTable.h"
+using namespace std;
+
+ProofTable::ProofTable(size_t megabytes) : buckets(nullptr), bucket_mask(0), eviction_count(0)
+{
+	static_assert(sizeof(Bucket) == 64, "three slots must fill a cache line");
+	resize(megabytes);
+}
+
+void ProofTable::resize(size_t megabytes)
+{
+	storage.reset();
+	buckets = nullptr;
+	for (;;)
+	{
+		const size_t wanted = (megabytes > 0 ? megabytes : 1) * 1024 * 1024 / sizeof(Bucket);
+		size_t count = 1;
+		while (count * 2 <= wanted)
+		{
+			count *= 2;
+		}
+		try
+		{
+			storage.reset(new char[count * sizeof(Bucket) + 64]);
+		}
+		catch (const bad_alloc &)
+		{
+			if (megabytes <= 1)
+			{
+				throw;
+			}
+			megabytes /= 2;
+			continue;
+		}
+		buckets = reinterpret_cast<Bucket *>((reinterpret_cast<uintptr_t>(storage.get()) + 63) & ~(uintptr_t)63);
+		bucket_mask = count - 1;
+		break;
+	}
+	clear();
+}
+
+void ProofTable::clear()
+{
+	for (uint64_t b = 0; b <= bucket_mask; b++)
+	{
+		for (Slot &slot : buckets[b].slots)
+		{
+			slot = Slot();
+		}
+	}
+	eviction_count = 0;
+}
+
+size_t ProofTable::used_count() const
+{
+	size_t used = 0;
+	for (uint64_t b = 0; b <= bucket_mask; b++)
+	{
+		lock_guard<mutex> guard(locks[b % LOCK_COUNT]);
+		for (const Slot &slot : buckets[b].slots)
+		{
+			used += !slot.empty();
+		}
+	}
+	return used;
+}
+
+bool ProofTable::probe(uint64_t key, Entry &entry) const
+{
+	const uint64_t b = key & bucket_mask;
+	lock_guard<mutex> guard(locks[b % LOCK_COUNT]);
+	for (const Slot &slot : buckets[b].slots)
+	{
+		if (slot.holds(key))
+		{
+			entry.proof = slot.proof;
+			entry.disproof = slot.disproof;
+			entry.move = slot.move;
+			entry.work = slot.work;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ProofTable::store(uint64_t key, const Entry &entry)
+{
+	const uint64_t b = key & bucket_mask;
+	lock_guard<mutex> guard(locks[b % LOCK_COUNT]);
+
+	// The same position first, then an empty slot, then the least work
+	Slot *victim = nullptr;
+	bool same_position = false;
+	for (Slot &slot : buckets[b].slots)
+	{
+		if (slot.holds(key))
+		{
+			victim = &slot;
+			same_position = true;
+			break;
+		}
+		if (victim == nullptr || (!victim->empty() && (slot.empty() || slot.work < victim->work)))
+		{
+			victim = &slot;
+		}
+	}
+	if (same_position && (victim->proof == 0 || victim->disproof == 0))
+	{
+		return;
+	}
+	if (!same_position && !victim->empty())
+	{
+		eviction_count++;
+	}
+
+	victim->key_low = (uint32_t)key;
+	victim->key_high = (uint32_t)(key >> 32);
+	victim->proof = entry.proof;
+	victim->disproof = entry.disproof;
+	victim->move = (int16_t)entry.move;
+	victim->work = (uint16_t)(entry.work < 0xFFFF ? entry.work : 0xFFFF);
+}
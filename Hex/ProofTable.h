@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Fixed size hash table of proof and disproof numbers for ProofSearch.
+// Entries are grouped three to a 64 byte bucket aligned to a cache line. A slot
+// keeps the whole of its key, since a proof read for the wrong position would
+// make the solver report a win that isn't there.
+//
+// Once the table is full a new position evicts the entry of its bucket with the
+// least work behind it, so what survives is what would cost the most to find
+// again. An evicted position only loses its numbers, which the search starts
+// over from their first estimate, so a small table makes a proof slower but
+// never wrong.
+//
+// Several threads share one table. Buckets are guarded by a fixed set of locks,
+// each lock covering every bucket whose index matches it in the low bits.
+class ProofTable
+{
+public:
+	// Numbers at or above INFINITE mean proven (pn 0, dn INFINITE) or disproven
+	static const uint32_t INFINITE = 0xFFFFFFFF;
+
+	struct Entry
+	{
+		uint32_t proof;
+		uint32_t disproof;
+		int move;      // the winning move once proven, else the last one searched, -1 for none
+		uint32_t work; // positions searched below this one, saturating
+	};
+
+	explicit ProofTable(size_t megabytes = 64);
+
+	// Reallocates the table with as many buckets as fit in the given size,
+	// rounded down to a power of two. When the memory isn't there it settles
+	// for half as much, down to a single megabyte, and only throws if even
+	// that fails. Everything stored so far is lost.
+	void resize(size_t megabytes);
+
+	void clear();
+
+	bool probe(uint64_t key, Entry &entry) const;
+
+	// A proven or disproven position keeps its result, whatever is stored for
+	// it later by a thread that hadn't seen it yet
+	void store(uint64_t key, const Entry &entry);
+
+	// What the table really got from resize(), and how many slots hold a position
+	inline size_t megabytes() const { return (size_t)(bucket_mask + 1) * sizeof(Bucket) / (1024 * 1024); };
+	inline size_t entry_count() const { return (size_t)(bucket_mask + 1) * BUCKET_SIZE; };
+	size_t used_count() const;
+
+	// Positions that pushed another one out, a measure of how short of room the table is
+	inline uint64_t evictions() const { return eviction_count; };
+
+private:
+	static const int BUCKET_SIZE = 3;
+	static const int LOCK_COUNT = 256;
+
+	// The key is kept in two halves so a slot is 20 bytes and three fit a
+	// line. work is kept in 16 bits, which is plenty to tell big subtrees from
+	// small ones. No position has both numbers 0, so that is an empty slot.
+	struct Slot
+	{
+		uint32_t key_low;
+		uint32_t key_high;
+		uint32_t proof;
+		uint32_t disproof;
+		int16_t move;
+		uint16_t work;
+
+		inline bool empty() const { return proof == 0 && disproof == 0; };
+		inline bool holds(uint64_t key) const { return key_low == (uint32_t)key && key_high == (uint32_t)(key >> 32) && !empty(); };
+	};
+
+	struct Bucket
+	{
+		Slot slots[BUCKET_SIZE];
+		uint32_t unused;
+	};
+
+	std::unique_ptr<char[]> storage;
+	Bucket *buckets;
+	uint64_t bucket_mask;
+	mutable std::mutex locks[LOCK_COUNT];
+	std::atomic<uint64_t> eviction_count;
+};
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include "InferiorCells.h"
+#include "Search.h"
+using namespace std;
+
+// Scores this close to WIN_SCORE are wins found by the search rather than
+// heuristic values. No game lasts more plies than a 19x19 board has cells.
+static const int WIN_THRESHOLD = MinimaxSearch<0>::WIN_SCORE - 1000;
+
+// The table is shared by searches from different roots, so wins are stored as
+// distance from the node and turned back into distance from the root on a hit
+static int score_to_table(int score, int ply)
+{
+	if (score >= WIN_THRESHOLD) return score + ply;
+	if (score <= -WIN_THRESHOLD) return score - ply;
+	return score;
+}
+
+static int score_from_table(int score, int ply)
+{
+	if (score >= WIN_THRESHOLD) return score - ply;
+	if (score <= -WIN_THRESHOLD) return score + ply;
+	return score;
+}
+
+template <int N>
+MinimaxSearch<N>::MinimaxSearch(HexBoard<N> &board, TranspositionTable *table) : board(board), table(table), previous_length(0), max_ply(0), node_count(0), last_depth(0), table_probes(0), table_hits(0), stats(nullptr), has_deadline(false), stopped(false), stop_flag(nullptr)
+{
+	history = vector<int>(2 * board.tables().cell_count());
+}
+
+// Warm up the per-ply buffers so the search itself never allocates
+template <int N>
+void MinimaxSearch<N>::reserve(int depth)
+{
+	const int cells = board.tables().cell_count();
+	const size_t needed = (size_t)(depth + 1) * cells;
+	if (move_buffer.size() < needed)
+	{
+		move_buffer.resize(needed);
+		score_buffer.resize(needed);
+	}
+
+	if (depth + 1 > max_ply)
+	{
+		max_ply = depth + 1;
+		pv_table.resize((size_t)max_ply * max_ply);
+		pv_length.resize(max_ply);
+		previous_pv.resize(max_ply);
+		killers.resize(2 * max_ply);
+	}
+	fill(killers.begin(), killers.end(), -1);
+}
+
+template <int N>
+ai_move MinimaxSearch<N>::minimax(int depth, HexGame::Player player, pair<int, int> cord, int alpha, int beta)
+{
+	reserve(depth);
+	previous_length = 0;
+	has_deadline = false;
+	stopped = false;
+
+	int index = -1;
+	if (cord.first >= 0 && cord.first < board.V() && cord.second >= 0 && cord.second < board.V())
+	{
+		index = board.index_of(cord.first, cord.second);
+	}
+	if (HEX_SEARCH_STATS && stats)
+	{
+		stats->clear();
+	}
+	const stats_mark mark = mark_stats();
+	const int score = search(depth, 0, player, index, alpha, beta, false);
+	record_iteration(mark, depth, score);
+	const ai_move result = root_result(score);
+	flush_counts();
+	return result;
+}
+
+template <int N>
+ai_move MinimaxSearch<N>::iterative_deepening(HexGame::Player player, pair<int, int> cord, int milliseconds, int max_depth, int first_depth)
+{
+	// There is nothing to gain from searching deeper than the board has blanks
+	int limit = board.blank_count();
+	if (max_depth > 0 && max_depth < limit)
+	{
+		limit = max_depth;
+	}
+	reserve(limit);
+	previous_length = 0;
+	has_deadline = false;
+	stopped = false;
+
+	int index = -1;
+	if (cord.first >= 0 && cord.first < board.V() && cord.second >= 0 && cord.second < board.V())
+	{
+		index = board.index_of(cord.first, cord.second);
+	}
+
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	const chrono::milliseconds budget(milliseconds);
+
+	ai_move best_move(0);
+	best_move.x = -1;
+	best_move.y = -1;
+	if (HEX_SEARCH_STATS && stats)
+	{
+		stats->clear();
+	}
+	for (int depth = first_depth < limit ? first_depth : limit; depth <= limit; depth++)
+	{
+		const stats_mark mark = mark_stats();
+		const int score = search(depth, 0, player, index, -INT_MAX, INT_MAX, true);
+		record_iteration(mark, depth, score);
+		if (stopped)
+		{
+			break;
+		}
+
+		best_move = root_result(score);
+		last_depth = depth;
+		previous_length = pv_length[0];
+		copy(pv_table.begin(), pv_table.begin() + previous_length, previous_pv.begin());
+
+		if (score >= WIN_THRESHOLD || score <= -WIN_THRESHOLD)
+		{
+			break;
+		}
+
+		if (milliseconds > 0)
+		{
+			// An iteration takes several times longer than the one before it,
+			// so one that starts past half the budget is unlikely to finish
+			const chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - start;
+			if (elapsed * 2 >= budget)
+			{
+				break;
+			}
+			deadline = start + budget;
+			has_deadline = true;
+		}
+	}
+
+	has_deadline = false;
+	flush_counts();
+	return best_move;
+}
+
+template <int N>
+void MinimaxSearch<N>::flush_counts()
+{
+	if (table)
+	{
+		table->add_counts(table_probes, table_hits);
+	}
+	table_probes = 0;
+	table_hits = 0;
+}
+
+template <int N>
+typename MinimaxSearch<N>::stats_mark MinimaxSearch<N>::mark_stats() const
+{
+	stats_mark mark;
+#if HEX_SEARCH_STATS
+	mark.nodes = node_count;
+	mark.table_probes = table_probes;
+	mark.table_hits = table_hits;
+	mark.counters = counters;
+	mark.time = chrono::steady_clock::now();
+#endif
+	return mark;
+}
+
+template <int N>
+void MinimaxSearch<N>::record_iteration(const stats_mark &mark, int depth, int score)
+{
+#if HEX_SEARCH_STATS
+	if (!stats)
+	{
+		return;
+	}
+	IterationStats iteration;
+	iteration.depth = depth;
+	iteration.score = stopped ? 0 : score;
+	iteration.complete = !stopped;
+	iteration.nodes = node_count - mark.nodes;
+	iteration.leaf_evaluations = counters.leaf_evaluations - mark.counters.leaf_evaluations;
+	iteration.cutoffs = counters.cutoffs - mark.counters.cutoffs;
+	iteration.first_move_cutoffs = counters.first_move_cutoffs - mark.counters.first_move_cutoffs;
+	iteration.table_probes = table_probes - mark.table_probes;
+	iteration.table_hits = table_hits - mark.table_hits;
+	iteration.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - mark.time).count();
+
+	// A stopped iteration leaves a half built line behind
+	if (!stopped)
+	{
+		iteration.pv.assign(pv_table.begin(), pv_table.begin() + pv_length[0]);
+	}
+	stats->iterations.push_back(iteration);
+#else
+	(void)mark;
+	(void)depth;
+	(void)score;
+#endif
+}
+
+template <int N>
+ai_move MinimaxSearch<N>::root_result(int score) const
+{
+	ai_move move(score);
+	move.x = pv_length[0] > 0 ? pv_table[0] / board.V() : -1;
+	move.y = pv_length[0] > 0 ? pv_table[0] % board.V() : -1;
+	return move;
+}
+
+template <int N>
+bool MinimaxSearch<N>::out_of_time()
+{
+	// Reading the clock costs more than a node, so only look every 1024 nodes
+	if ((node_count & 1023) == 0 && !stopped)
+	{
+		if (stop_flag && stop_flag->load(memory_order_relaxed))
+		{
+			stopped = true;
+		}
+		else if (has_deadline && chrono::steady_clock::now() >= deadline)
+		{
+			stopped = true;
+		}
+	}
+	return stopped;
+}
+
+template <int N>
+void MinimaxSearch<N>::score_moves(int ply, HexGame::Player player, const int *moves, int *scores, int move_total, int hash_move, bool on_pv) const
+{
+	const int pv_move = on_pv && ply < previous_length ? previous_pv[ply] : -1;
+	const int *player_history = &history[player * board.tables().cell_count()];
+	for (int i = 0; i < move_total; i++)
+	{
+		const int move = moves[i];
+		if (move == hash_move) scores[i] = 1 << 30;
+		else if (move == pv_move) scores[i] = 1 << 29;
+		else if (move == killers[2 * ply]) scores[i] = 1 << 28;
+		else if (move == killers[2 * ply + 1]) scores[i] = 1 << 27;
+		else scores[i] = player_history[move];
+	}
+}
+
+// The implementation of minimax for a hexboard.
+// Returns the score of the position and leaves the best line in pv_table[ply].
+template <int N>
+int MinimaxSearch<N>::search(int depth, int ply, HexGame::Player player, int cord, int alpha, int beta, bool on_pv)
+{
+	node_count++;
+	pv_length[ply] = 0;
+
+	if (out_of_time())
+	{
+		return 0;
+	}
+
+	// The move that led here may have ended the game
+	const HexGame::Player winner = board.check_winner();
+	if (winner != HexGame::BLANK)
+	{
+		return winner == HexGame::BLUE ? WIN_SCORE - ply : -(WIN_SCORE - ply);
+	}
+
+	const int move_total = board.blank_count();
+	if (depth == 0 || move_total == 0)
+	{
+		counters.leaf();
+		return board.get_score(HexGame::BLUE, cord) - board.get_score(HexGame::RED, cord);
+	}
+
+	// Leaves are scored from the last move, so only interior nodes go in the table.
+	// Below depth 1 every result depends on the position alone.
+	const uint64_t key = board.hash() ^ (player == HexGame::BLUE ? board.tables().zobrist_side : 0);
+	int hash_move = -1;
+	TranspositionTable::Entry entry;
+	table_probes += table != nullptr;
+	if (table && table->probe(key, entry))
+	{
+		table_hits++;
+		hash_move = entry.move;
+
+		// The root always searches so that it has a move to return
+		if (entry.depth >= depth && ply > 0)
+		{
+			const int score = score_from_table(entry.score, ply);
+			if (entry.bound == TranspositionTable::LOWER)
+			{
+				alpha = alpha > score ? alpha : score;
+			}
+			else if (entry.bound == TranspositionTable::UPPER)
+			{
+				beta = beta < score ? beta : score;
+			}
+
+			if (entry.bound == TranspositionTable::EXACT || beta <= alpha)
+			{
+				return score;
+			}
+		}
+	}
+	const int alpha_start = alpha;
+	const int beta_start = beta;
+
+	// Children reorder the board's blank list while they run, so this ply
+	// works from its own copy of it
+	const int cells = board.tables().cell_count();
+	int *moves = &move_buffer[(size_t)ply * cells];
+	int *scores = &score_buffer[(size_t)ply * cells];
+	copy(board.blank_list(), board.blank_list() + move_total, moves);
+
+	// Dead and captured cells can't be better than the other moves. When they
+	// are all that's left the position is decided, but searching them is the
+	// easiest way to find out for whom.
+	int candidate_total = move_total;
+	if (board.prunes_inferior_cells())
+	{
+		const typename HexBoard<N>::Bits inferior = inferior_cells(board);
+		int kept = 0;
+		for (int i = 0; i < move_total; i++)
+		{
+			if (!inferior.test(moves[i]))
+			{
+				moves[kept++] = moves[i];
+			}
+		}
+		candidate_total = kept > 0 ? kept : move_total;
+	}
+	score_moves(ply, player, moves, scores, candidate_total, hash_move, on_pv);
+
+	const bool maximizing = player == HexGame::BLUE;
+	const HexGame::Player opponent = maximizing ? HexGame::RED : HexGame::BLUE;
+	int best_score = maximizing ? -INT_MAX : INT_MAX;
+	int best_index = -1;
+
+	for (int i = 0; i < candidate_total; i++)
+	{
+		// Pick the best ordered move that is left. Most nodes cut off after a few
+		// moves, so this is cheaper than sorting the whole list up front.
+		int pick = i;
+		for (int j = i + 1; j < candidate_total; j++)
+		{
+			if (scores[j] > scores[pick]) pick = j;
+		}
+		swap(moves[i], moves[pick]);
+		swap(scores[i], scores[pick]);
+		const int move = moves[i];
+
+		board.make_index(player, move);
+		const bool child_on_pv = on_pv && ply < previous_length && move == previous_pv[ply];
+		const int v = search(depth - 1, ply + 1, opponent, move, alpha, beta, child_on_pv);
+		board.unmake_index();
+		if (stopped)
+		{
+			return 0;
+		}
+
+		if (best_index < 0 || (maximizing ? v > best_score : v < best_score))
+		{
+			best_score = v;
+			best_index = move;
+
+			int *line = &pv_table[(size_t)ply * max_ply];
+			const int *child_line = &pv_table[(size_t)(ply + 1) * max_ply];
+			line[0] = move;
+			copy(child_line, child_line + pv_length[ply + 1], line + 1);
+			pv_length[ply] = pv_length[ply + 1] + 1;
+		}
+
+		if (maximizing)
+		{
+			alpha = alpha > v ? alpha : v;
+		}
+		else
+		{
+			beta = beta < v ? beta : v;
+		}
+
+		if (beta <= alpha)
+		{
+			counters.cutoff(i == 0);
+
+			// Remember the refutation for siblings of this node and for later searches
+			if (killers[2 * ply] != move)
+			{
+				killers[2 * ply + 1] = killers[2 * ply];
+				killers[2 * ply] = move;
+			}
+			int &credit = history[player * cells + move];
+			credit += depth * depth;
+			if (credit > (1 << 24))
+			{
+				for (int &h : history) h /= 2;
+			}
+			break;
+		}
+	}
+
+	if (table)
+	{
+		TranspositionTable::Bound bound = TranspositionTable::EXACT;
+		if (best_score <= alpha_start)
+		{
+			bound = TranspositionTable::UPPER;
+		}
+		else if (best_score >= beta_start)
+		{
+			bound = TranspositionTable::LOWER;
+		}
+		table->store(key, depth, bound, score_to_table(best_score, ply), best_index);
+	}
+
+	return best_score;
+}
+
+#define INSTANTIATE(N) template class MinimaxSearch<N>;
+HEX_ALL_SIZES(INSTANTIATE)
+#undef INSTANTIATE
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "HexBoard.h"
+#include "SearchStats.h"
+#include "TranspositionTable.h"
+
+// Depth limited minimax with alpha-beta pruning over a single board.
+// Moves are played with make_index() and taken back with unmake_index(), so the
+// board is left exactly as it was found and no node copies it.
+// Scores are from BLUE's point of view: BLUE maximizes and RED minimizes.
+template <int N>
+class MinimaxSearch
+{
+public:
+	// A won position scores WIN_SCORE minus the plies it took to get there,
+	// so the search prefers the fastest win and the slowest loss
+	static const int WIN_SCORE = 1000000;
+
+	// table may be null, in which case every node is searched from scratch
+	explicit MinimaxSearch(HexBoard<N> &board, TranspositionTable *table = nullptr);
+
+	// Searches depth plies ahead with player to move and returns the best move
+	// for that player. cord is the last move played, which is what gets scored
+	// if the search can't go any deeper.
+	ai_move minimax(int depth, HexGame::Player player, std::pair<int, int> cord, int alpha = -INT_MAX, int beta = INT_MAX);
+
+	// Searches depth 1, 2, 3, ... until the time budget runs out, max_depth is
+	// reached or the result is a forced win or loss. Returns the best move of the
+	// last depth that completed, depth 1 always completes. A budget or max_depth
+	// of 0 means no limit. Helper threads pass a later first_depth so they don't
+	// all search the same depth at the same time.
+	ai_move iterative_deepening(HexGame::Player player, std::pair<int, int> cord, int milliseconds, int max_depth = 0, int first_depth = 1);
+
+	// Another thread can end the search early by setting this flag. A stopped
+	// search returns the result of the last depth it completed, if any.
+	inline void set_stop_flag(const std::atomic<bool> *flag) { stop_flag = flag; };
+
+	// Every later search clears stats and fills it in with one entry per
+	// iteration. Only HEX_SEARCH_STATS builds do, others leave it alone.
+	inline void set_stats(SearchStats *stats) { this->stats = stats; };
+
+	// Nodes visited by every search on this object so far
+	inline uint64_t nodes() const { return node_count; };
+
+	// Deepest iteration iterative_deepening() finished
+	inline int completed_depth() const { return last_depth; };
+
+private:
+	int search(int depth, int ply, HexGame::Player player, int cord, int alpha, int beta, bool on_pv);
+
+	// Scores the candidate moves of a ply, best first: the table move, the move of
+	// the previous iteration's principal variation, the two killers, then history
+	void score_moves(int ply, HexGame::Player player, const int *moves, int *scores, int move_total, int hash_move, bool on_pv) const;
+
+	// Where the counters stood when an iteration started
+	struct stats_mark {
+		uint64_t nodes;
+		uint64_t table_probes;
+		uint64_t table_hits;
+		SearchCounters counters;
+		std::chrono::steady_clock::time_point time;
+	};
+
+	stats_mark mark_stats() const;
+	void record_iteration(const stats_mark &mark, int depth, int score);
+
+	ai_move root_result(int score) const;
+	void flush_counts();
+	void reserve(int depth);
+	bool out_of_time();
+
+	HexBoard<N> &board;
+	TranspositionTable *table;
+
+	// One slice of board size entries per ply for that ply's candidate moves
+	// and their ordering scores. They only grow when a deeper search than before
+	// is started.
+	std::vector<int> move_buffer;
+	std::vector<int> score_buffer;
+
+	// Triangular principal variation table, ply p owns the row starting at
+	// p * max_ply, and the line found by the last completed iteration
+	std::vector<int> pv_table;
+	std::vector<int> pv_length;
+	std::vector<int> previous_pv;
+	int previous_length;
+	int max_ply;
+
+	// Two most recent moves per ply that caused a cutoff
+	std::vector<int> killers;
+
+	// How often each cell caused a cutoff for each player, weighted by depth
+	std::vector<int> history;
+
+	uint64_t node_count;
+	int last_depth;
+
+	uint64_t table_probes;
+	uint64_t table_hits;
+
+	SearchCounters counters;
+	SearchStats *stats;
+
+	bool has_deadline;
+	bool stopped;
+	std::chrono::steady_clock::time_point deadline;
+	const std::atomic<bool> *stop_flag;
+};
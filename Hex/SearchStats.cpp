@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <string>
+#include "HexGame.h"
+#include "SearchStats.h"
+using namespace std;
+
+double SearchStats::branching_factor(size_t iteration) const
+{
+	if (iteration == 0 || iteration >= iterations.size() || iterations[iteration - 1].nodes == 0)
+	{
+		return 0.0;
+	}
+	return (double)iterations[iteration].nodes / iterations[iteration - 1].nodes;
+}
+
+// A number with a fixed count of decimals, the way the JSON has always had them
+static string decimals(double value, int digits)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%.*f", digits, value);
+	return text;
+}
+
+void SearchStats::write_json(ostream &out, int size) const
+{
+	uint64_t nodes = 0;
+	double milliseconds = 0.0;
+	const IterationStats *last = nullptr;
+	for (const IterationStats &iteration : iterations)
+	{
+		nodes += iteration.nodes;
+		milliseconds += iteration.milliseconds;
+		if (iteration.complete)
+		{
+			last = &iteration;
+		}
+	}
+
+	out << "{\"move\": \"" << (last && !last->pv.empty() ? HexGame::cell_name(last->pv[0] / size, last->pv[0] % size) : "")
+		<< "\", \"score\": " << (last ? last->score : 0) << ", \"depth\": " << (last ? last->depth : 0) << ", \"nodes\": " << nodes
+		<< ", \"ms\": " << decimals(milliseconds, 3) << ", \"iterations\": [";
+	for (size_t i = 0; i < iterations.size(); i++)
+	{
+		const IterationStats &iteration = iterations[i];
+		const double first_move_rate = iteration.cutoffs ? (double)iteration.first_move_cutoffs / iteration.cutoffs : 0.0;
+		out << (i ? ", " : "") << "{\"depth\": " << iteration.depth << ", \"complete\": " << (iteration.complete ? "true" : "false")
+			<< ", \"score\": " << iteration.score << ", \"nodes\": " << iteration.nodes << ", \"leaf_evaluations\": " << iteration.leaf_evaluations
+			<< ", \"cutoffs\": " << iteration.cutoffs << ", \"first_move_cutoff_rate\": " << decimals(first_move_rate, 3)
+			<< ", \"table_probes\": " << iteration.table_probes << ", \"table_hits\": " << iteration.table_hits
+			<< ", \"ebf\": " << decimals(branching_factor(i), 2) << ", \"ms\": " << decimals(iteration.milliseconds, 3) << ", \"pv\": [";
+		for (size_t j = 0; j < iteration.pv.size(); j++)
+		{
+			out << (j ? ", \"" : "\"") << HexGame::cell_name(iteration.pv[j] / size, iteration.pv[j] % size) << "\"";
+		}
+		out << "]}";
+	}
+	out << "]}\n";
+}
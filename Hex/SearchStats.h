@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Builds with HEX_SEARCH_STATS=1 have minimax keep statistics about every
+// search. Without it SearchCounters is empty, its calls compile to nothing and
+// no SearchStats is ever filled in, so release builds pay nothing for them.
+#ifndef HEX_SEARCH_STATS
+#define HEX_SEARCH_STATS 0
+#endif
+
+// One depth of an iterative deepening search
+struct IterationStats
+{
+	int depth;
+	int score;
+	bool complete;              // false for the iteration the clock cut short
+	uint64_t nodes;
+	uint64_t leaf_evaluations;  // calls to get_score()
+	uint64_t cutoffs;
+	uint64_t first_move_cutoffs; // cutoffs by the first move searched
+	uint64_t table_probes;
+	uint64_t table_hits;
+	double milliseconds;
+	std::vector<int> pv;        // principal variation as cell indices
+};
+
+// What a minimax search did, one entry per iteration it started
+struct SearchStats
+{
+	std::vector<IterationStats> iterations;
+
+	inline void clear() { iterations.clear(); };
+
+	// Nodes of an iteration over the nodes of the one before it, 0 for the first
+	double branching_factor(size_t iteration) const;
+
+	// The whole search as one JSON object on one line, cells named for an
+	// NxN board of the given size
+	void write_json(std::ostream &out, int size) const;
+};
+
+// Counters the search bumps in its inner loop
+struct SearchCounters
+{
+#if HEX_SEARCH_STATS
+	uint64_t leaf_evaluations = 0;
+	uint64_t cutoffs = 0;
+	uint64_t first_move_cutoffs = 0;
+
+	inline void leaf() { leaf_evaluations++; };
+	inline void cutoff(bool first_move) { cutoffs++; first_move_cutoffs += first_move; };
+#else
+	inline void leaf() {};
+	inline void cutoff(bool) {};
+#endif
+};
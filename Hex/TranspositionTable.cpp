@@ -0,0 +1,147 @@
+#include <new>
+#include "TranspositionTable.h"
+using namespace std;
+
+static uint64_t pack(int depth, TranspositionTable::Bound bound, int score, int move, int age)
+{
+	return (uint64_t)(uint32_t)score
+		| (uint64_t)(uint16_t)move << 32
+		| (uint64_t)(uint8_t)depth << 48
+		| (uint64_t)bound << 56
+		| (uint64_t)(age & 63) << 58;
+}
+
+static inline int packed_score(uint64_t data) { return (int)(int32_t)(uint32_t)data; }
+static inline int packed_move(uint64_t data) { return (int)(int16_t)(uint16_t)(data >> 32); }
+static inline int packed_depth(uint64_t data) { return (int)(uint8_t)(data >> 48); }
+static inline TranspositionTable::Bound packed_bound(uint64_t data) { return (TranspositionTable::Bound)((data >> 56) & 3); }
+static inline int packed_age(uint64_t data) { return (int)(data >> 58); }
+
+TranspositionTable::TranspositionTable(size_t megabytes) : buckets(nullptr), bucket_mask(0), generation(0), probe_count(0), hit_count(0)
+{
+	static_assert(sizeof(Bucket) == 64, "four slots must fill a cache line");
+	resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+	const size_t wanted = megabytes * 1024 * 1024 / sizeof(Bucket);
+	size_t count = 1;
+	while (count * 2 <= wanted)
+	{
+		count *= 2;
+	}
+
+	storage.reset(new char[count * sizeof(Bucket) + 64]);
+	buckets = reinterpret_cast<Bucket *>((reinterpret_cast<uintptr_t>(storage.get()) + 63) & ~(uintptr_t)63);
+	for (size_t i = 0; i < count; i++)
+	{
+		new (&buckets[i]) Bucket();
+	}
+	bucket_mask = count - 1;
+	clear();
+}
+
+void TranspositionTable::clear()
+{
+	for (uint64_t b = 0; b <= bucket_mask; b++)
+	{
+		for (Slot &slot : buckets[b].slots)
+		{
+			slot.check.store(0, memory_order_relaxed);
+			slot.data.store(0, memory_order_relaxed);
+		}
+	}
+	generation = 0;
+	probe_count = 0;
+	hit_count = 0;
+}
+
+void TranspositionTable::new_search()
+{
+	generation++;
+	probe_count = 0;
+	hit_count = 0;
+}
+
+void TranspositionTable::add_counts(uint64_t probes, uint64_t hits)
+{
+	probe_count += probes;
+	hit_count += hits;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry &entry) const
+{
+	const Bucket &bucket = buckets[key & bucket_mask];
+	for (int i = 0; i < BUCKET_SIZE; i++)
+	{
+		const uint64_t data = bucket.slots[i].data.load(memory_order_relaxed);
+		const uint64_t check = bucket.slots[i].check.load(memory_order_relaxed);
+		if ((check ^ data) == key && packed_bound(data) != NO_BOUND)
+		{
+			entry.score = packed_score(data);
+			entry.move = packed_move(data);
+			entry.depth = packed_depth(data);
+			entry.bound = packed_bound(data);
+			return true;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, int move)
+{
+	Bucket &bucket = buckets[key & bucket_mask];
+	const int age = generation & 63;
+
+	// Look for the same position first, otherwise pick the least valuable entry.
+	// Empty slots are worth nothing, old generations come next, then shallow depths.
+	Slot *victim = nullptr;
+	uint64_t victim_data = 0;
+	bool same_position = false;
+	int victim_worth = INT32_MAX;
+	for (int i = 0; i < BUCKET_SIZE; i++)
+	{
+		Slot &candidate = bucket.slots[i];
+		const uint64_t data = candidate.data.load(memory_order_relaxed);
+		const uint64_t check = candidate.check.load(memory_order_relaxed);
+		if ((check ^ data) == key && packed_bound(data) != NO_BOUND)
+		{
+			victim = &candidate;
+			victim_data = data;
+			same_position = true;
+			break;
+		}
+
+		int worth = -1;
+		if (packed_bound(data) != NO_BOUND)
+		{
+			worth = packed_depth(data) + (packed_age(data) == age ? 256 : 0);
+		}
+		if (worth < victim_worth)
+		{
+			victim = &candidate;
+			victim_worth = worth;
+		}
+	}
+
+	if (same_position)
+	{
+		if (depth < packed_depth(victim_data) && packed_age(victim_data) == age)
+		{
+			// Keep the deeper result but mark it as still in use
+			const uint64_t data = pack(packed_depth(victim_data), packed_bound(victim_data), packed_score(victim_data), packed_move(victim_data), age);
+			victim->data.store(data, memory_order_relaxed);
+			victim->check.store(key ^ data, memory_order_relaxed);
+			return;
+		}
+		if (move < 0)
+		{
+			move = packed_move(victim_data);
+		}
+	}
+
+	const uint64_t data = pack(depth < 255 ? depth : 255, bound, score, move, age);
+	victim->data.store(data, memory_order_relaxed);
+	victim->check.store(key ^ data, memory_order_relaxed);
+}
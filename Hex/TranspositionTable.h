@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed size hash table of search results keyed by Zobrist hash.
+// Entries are grouped four to a 64 byte bucket, and buckets are aligned to cache
+// lines, so a probe or a store touches exactly one line of memory.
+//
+// Several searches may use one table from different threads without locking.
+// Each slot holds its packed data word and the key xor that word, so a slot
+// that is torn by two threads writing at once no longer matches its key and
+// reads as a miss instead of as a wrong result.
+class TranspositionTable
+{
+public:
+	enum Bound { NO_BOUND, EXACT, LOWER, UPPER };
+
+	struct Entry
+	{
+		int score;
+		int move;  // cell index of the best move, -1 when there is none
+		int depth;
+		Bound bound;
+	};
+
+	explicit TranspositionTable(size_t megabytes = 16);
+
+	// Reallocates the table with as many buckets as fit in the given size,
+	// rounded down to a power of two. Everything stored so far is lost.
+	void resize(size_t megabytes);
+
+	void clear();
+
+	// Starts a new generation and resets the hit counters. Entries from older
+	// generations are the first to be replaced.
+	void new_search();
+
+	bool probe(uint64_t key, Entry &entry) const;
+
+	// Depth preferred: a result never replaces a deeper one for the same position
+	// from this generation, exact or not, and a new position evicts the
+	// shallowest or oldest entry
+	void store(uint64_t key, int depth, Bound bound, int score, int move);
+
+	// Searches count their own probes and hand them over when they finish,
+	// which keeps the threads from fighting over one counter
+	void add_counts(uint64_t probes, uint64_t hits);
+
+	inline uint64_t probes() const { return probe_count; };
+	inline uint64_t hits() const { return hit_count; };
+	inline double hit_rate() const { return probe_count ? (double)hit_count / probe_count : 0.0; };
+
+	inline size_t entry_count() const { return (size_t)(bucket_mask + 1) * BUCKET_SIZE; };
+
+private:
+	static const int BUCKET_SIZE = 4;
+
+	// data packs score (32 bits), move (16), depth (8), bound (2) and age (6)
+	struct Slot
+	{
+		std::atomic<uint64_t> check; // key ^ data
+		std::atomic<uint64_t> data;
+	};
+
+	struct Bucket
+	{
+		Slot slots[BUCKET_SIZE];
+	};
+
+	// Raw allocation with room to round the bucket array up to a 64 byte boundary
+	std::unique_ptr<char[]> storage;
+	Bucket *buckets;
+	uint64_t bucket_mask;
+
+	uint8_t generation;
+	std::atomic<uint64_t> probe_count;
+	std::atomic<uint64_t> hit_count;
+};
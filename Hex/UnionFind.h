@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+// Disjoint sets with union by size and an undo log.
+// Path compression is left out on purpose: without it every union only changes
+// one parent link and one size, so rolling it back is two stores. Union by size
+// keeps the trees at most log2(n) deep, which is 8 for a 19x19 board.
+class UnionFind
+{
+public:
+	UnionFind(int count = 0) : parent(count), size(count)
+	{
+		history.reserve(count);
+		reset();
+	}
+
+	// Puts every element back into its own set and forgets the undo log
+	void reset()
+	{
+		for (unsigned int i = 0; i < parent.size(); i++)
+		{
+			parent[i] = i;
+			size[i] = 1;
+		}
+		history.clear();
+	}
+
+	int find(int x) const
+	{
+		while (parent[x] != x) x = parent[x];
+		return x;
+	}
+
+	inline bool same(int a, int b) const { return find(a) == find(b); }
+
+	// Merges the sets of a and b, returns false when they were already joined
+	bool unite(int a, int b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a == b) return false;
+
+		if (size[a] < size[b])
+		{
+			int t = a;
+			a = b;
+			b = t;
+		}
+		parent[b] = a;
+		size[a] += size[b];
+		history.push_back(b);
+		return true;
+	}
+
+	// A marker for the current state that rollback() can return to
+	inline int checkpoint() const { return (int)history.size(); }
+
+	// Undoes every union made since the checkpoint, newest first
+	void rollback(int checkpoint)
+	{
+		while ((int)history.size() > checkpoint)
+		{
+			const int child = history.back();
+			history.pop_back();
+			size[parent[child]] -= size[child];
+			parent[child] = child;
+		}
+	}
+
+private:
+	std::vector<int> parent;
+	std::vector<int> size;
+
+	// Roots that were attached to another root, in the order it happened.
+	// There can never be more of them than elements, so reserving that many
+	// up front means unite() never allocates.
+	std::vector<int> history;
+};